@@ -33,6 +33,7 @@
 #include "../utils/stats.h"
 #include "../utils/parse_results.h"
 #include "../utils/check_nn_recall.h"
+#include "../utils/index_file.h"
 #include "hcnng_index.h"
 
 extern bool report_stats;
@@ -54,6 +55,11 @@ void ANN(parlay::sequence<Tvec_point<T>*> &v, int k, int mstDeg,
   } else{idx_time=0;}
   std::string name = "HCNNG";
   std::string params = "Trees = " + std::to_string(num_clusters);
+  if(!graph_built){
+    index_info.algorithm = name;
+    index_info.params = params + ", MST degree = " + std::to_string(mstDeg) +
+      ", cluster size = " + std::to_string((int) cluster_size);
+  }
   auto [avg_deg, max_deg] = graph_stats(v);
   Graph G(name, params, v.size(), avg_deg, max_deg, idx_time);
   G.print();
@@ -73,6 +79,9 @@ void ANN(parlay::sequence<Tvec_point<T>*> v, int MSTdeg, int num_clusters, doubl
     if(!graph_built){
       I.build_index(v, num_clusters, cluster_size);
       t.next("Built index");
+      index_info.algorithm = "HCNNG";
+      index_info.params = "Trees = " + std::to_string(num_clusters) + ", MST degree = " +
+        std::to_string(MSTdeg) + ", cluster size = " + std::to_string((int) cluster_size);
     }
     if(report_stats){
       graph_stats(v);
@@ -33,6 +33,7 @@
 #include "../utils/stats.h"
 #include "../utils/parse_results.h"
 #include "../utils/check_nn_recall.h"
+#include "../utils/index_file.h"
 
 extern bool report_stats;
 
@@ -57,6 +58,11 @@ void ANN(parlay::sequence<Tvec_point<T>*> &v, int k, int K, int cluster_size, in
 
     std::string name = "pyNNDescent";
     std::string params = "K = " + std::to_string(K);
+    if(!graph_built){
+      index_info.algorithm = name;
+      index_info.params = params + ", cluster size = " + std::to_string(cluster_size) +
+        ", alpha = " + std::to_string(alpha);
+    }
     auto [avg_deg, max_deg] = graph_stats(v);
     Graph G(name, params, v.size(), avg_deg, max_deg, idx_time);
     G.print();
@@ -75,6 +81,9 @@ void ANN(parlay::sequence<Tvec_point<T>*> v, int K, int cluster_size, double num
        findex I(K, d, .05, mips);
       I.build_index(v, cluster_size, (int) num_clusters, alpha);
       t.next("Built index");
+      index_info.algorithm = "pyNNDescent";
+      index_info.params = "K = " + std::to_string(K) + ", cluster size = " +
+        std::to_string(cluster_size) + ", alpha = " + std::to_string(alpha);
     }
     if(report_stats){
       graph_stats(v);
@@ -33,6 +33,7 @@
 #include "types.h"
 #include "indexTools.h"
 #include <functional>
+#include <limits>
 #include <random>
 
 extern bool report_stats;
@@ -80,77 +81,256 @@ std::pair<std::pair<parlay::sequence<pid>, parlay::sequence<pid>>, int> beam_sea
 
 }
 
-// updated version by Guy
+// an element of the beam: a point, its distance to the query, and
+// whether its neighbors have already been explored
+struct beam_elt {
+  int id;
+  float dist;
+  bool expanded;
+};
+
+// Per-thread buffers reused across queries so that a search does not
+// allocate.  The points whose distance has been computed are kept in
+// an open-addressing table whose entries are tagged with the query's
+// epoch, so starting a new query only bumps the epoch.
+struct beam_scratch {
+  std::vector<uint64_t> seen; // (epoch << 32) | id
+  uint64_t epoch = 0;
+  size_t num_seen = 0;
+  std::vector<beam_elt> frontier;
+  std::vector<beam_elt> merged;
+  std::vector<pid> candidates;
+  std::vector<pid> visited;
+  std::vector<int> unseen;
+  // used by filtered searches: the points that do not match the filter
+  // but are still explored, and the new ones among a neighborhood
+  std::vector<beam_elt> bridges;
+  std::vector<pid> bridge_candidates;
+
+  void start(int beamSize) {
+    size_t size = size_t{1} << std::max(10, (int) std::ceil(std::log2(beamSize*beamSize))-2);
+    if (seen.size() < size || epoch == (uint64_t{1} << 32) - 1) {
+      seen.assign(std::max(size, seen.size()), 0);
+      epoch = 0;
+    }
+    epoch++;
+    num_seen = 0;
+    frontier.clear();
+    visited.clear();
+    bridges.clear();
+  }
+
+  // returns true if a was not seen before in this query
+  bool insert(int a) {
+    if (2*(num_seen+1) > seen.size()) grow();
+    size_t mask = seen.size() - 1;
+    uint64_t key = (epoch << 32) | static_cast<uint32_t>(a);
+    size_t h = parlay::hash64_2(a) & mask;
+    while (true) {
+      if (seen[h] == key) return false;
+      if ((seen[h] >> 32) != epoch) {
+        seen[h] = key;
+        num_seen++;
+        return true;
+      }
+      h = (h + 1) & mask;
+    }
+  }
+
+  void grow() {
+    std::vector<uint64_t> old(2*seen.size(), 0);
+    std::swap(old, seen);
+    num_seen = 0;
+    for (uint64_t key : old)
+      if ((key >> 32) == epoch) insert(static_cast<int>(static_cast<uint32_t>(key)));
+  }
+};
+
+inline beam_scratch& get_beam_scratch() {
+  static thread_local beam_scratch scratch;
+  return scratch;
+}
+
+// brings the vector of a point into cache ahead of its distance evaluation
 template <typename T>
-std::pair<std::pair<parlay::sequence<pid>, parlay::sequence<pid>>, size_t> beam_search(
-    Tvec_point<T>* p, parlay::sequence<Tvec_point<T>*>& v,
-    parlay::sequence<Tvec_point<T>*> starting_points, int beamSize, unsigned d, bool mips, int k=0, float cut=1.14, int limit=-1) {
-  // initialize data structures
-  if(limit==-1) limit=v.size();
+inline void prefetch_vector(const T* a, unsigned d) {
+  const char* c = reinterpret_cast<const char*>(a);
+  for (size_t off = 0; off < d*sizeof(T); off += 64) __builtin_prefetch(c + off);
+}
+
+// The search itself; the beam is left in S.frontier in sorted order and
+// the explored points in S.visited in the order they were explored.
+// self is the id of the query if it is in the graph (or -1), start(i)
+// is the i-th of num_starts starting ids, and nbrs(a) is the
+// out-neighborhood of a, terminated by -1 if shorter than the slice.
+// dist(q) is the distance from p to point q, and prefetch(q) is called
+// on each new neighbor of the current point before any of their
+// distances are computed, so the loads of a whole neighborhood overlap.
+// Returns the number of distance computations.
+template <typename Start, typename Nbrs, typename Dist, typename Prefetch>
+size_t graph_search_scratch(
+    int self, size_t num_starts, Start& start, Nbrs& nbrs, Dist& dist, Prefetch& prefetch,
+    int beamSize, bool mips, int k, float cut, long limit, beam_scratch& S) {
+  if(limit==-1) limit=std::numeric_limits<long>::max();
   size_t dist_cmps = 0;
-  auto vvc = v[0]->coordinates.begin();
-  long stride = v[1]->coordinates.begin() - v[0]->coordinates.begin();
-  std::vector<pid> visited;
   auto less = [&](pid a, pid b) {
       return a.second < b.second || (a.second == b.second && a.first < b.first); };
-  auto make_pid = [&] (int q) {
-      if(mips) return std::pair{q, mips_distance(vvc + q*stride, p->coordinates.begin(), d)};
-      else return std::pair{q, distance(vvc + q*stride, p->coordinates.begin(), d)};
-  };
-  int bits = std::ceil(std::log2(beamSize*beamSize))-2;
-  parlay::sequence<int> hash_table(1 << bits, -1);
-
-  auto pre_frontier = parlay::tabulate(starting_points.size(), [&] (size_t i) {
-    return make_pid(starting_points[i]->id);
-  });
-
-  dist_cmps += starting_points.size();
+  auto elt_less = [&](const beam_elt& a, const beam_elt& b) {
+      return less(pid{a.id, a.dist}, pid{b.id, b.dist}); };
+  S.start(beamSize);
 
-  auto frontier = parlay::sort(pre_frontier, less);
+  for (size_t i = 0; i < num_starts; i++) {
+    int sp = start(i);
+    if (S.insert(sp)) S.frontier.push_back(beam_elt{sp, dist(sp), false});
+  }
+  dist_cmps += S.frontier.size();
+  std::sort(S.frontier.begin(), S.frontier.end(), elt_less);
+  if (S.frontier.size() > (size_t) beamSize) S.frontier.resize(beamSize);
 
-  std::vector<pid> unvisited_frontier(beamSize);
-  parlay::sequence<pid> new_frontier(beamSize + v[0]->out_nbh.size());
-  unvisited_frontier[0] = frontier[0];
-  int remain = 1;
-  int num_visited = 0;
+  // the frontier is sorted, so the next point to explore is always
+  // its first unexpanded element
+  long next = S.frontier.empty() ? -1 : 0;
+  long num_visited = 0;
 
   // terminate beam search when the entire frontier has been visited
-  while (remain > 0 && num_visited<limit) {
-    // the next node to visit is the unvisited frontier node that is closest to p
-    pid currentPid = unvisited_frontier[0];
-    Tvec_point<T>* current = v[currentPid.first];
-    auto nbh = current->out_nbh.cut(0, size_of(current->out_nbh));
-    auto candidates = parlay::filter(nbh,  [&] (int a) {
-	     int loc = parlay::hash64_2(a) & ((1 << bits) - 1);
-	     if (a == p->id || hash_table[loc] == a) return false;
-	     hash_table[loc] = a;
-	     return true;});
-    auto pairCandidates = parlay::map(candidates, [&] (long c) {return make_pid(c);}, 1000);
-    dist_cmps += candidates.size();
-    auto sortedCandidates = parlay::sort(pairCandidates, less);
-    auto f_iter = std::set_union(frontier.begin(), frontier.end(),
-				 sortedCandidates.begin(), sortedCandidates.end(),
-				 new_frontier.begin(), less);
-    size_t f_size = std::min<size_t>(beamSize, f_iter - new_frontier.begin());
-    if (k > 0 && f_size > k) {
-      if(mips){
-        f_size = (std::upper_bound(new_frontier.begin(), new_frontier.begin() + f_size,
-				std::pair{0, -cut * new_frontier[k].second}, less)
-		- new_frontier.begin());
+  while (next >= 0 && num_visited<limit) {
+    beam_elt& current = S.frontier[next];
+    current.expanded = true;
+    S.visited.push_back(pid{current.id, current.dist});
+    auto nbh = nbrs(current.id);
+
+    // collect and prefetch the new neighbors, then compute their
+    // distances in one batch
+    S.unseen.clear();
+    for (size_t j = 0; j < nbh.size(); j++) {
+      int a = nbh[j];
+      if (a == -1) break;
+      if (a == self || !S.insert(a)) continue;
+      prefetch(a);
+      S.unseen.push_back(a);
+    }
+    S.candidates.clear();
+    for (int a : S.unseen) S.candidates.push_back(pid{a, dist(a)});
+    dist_cmps += S.unseen.size();
+    std::sort(S.candidates.begin(), S.candidates.end(), less);
+
+    // merge the candidates into the beam, keeping the closest beamSize
+    S.merged.clear();
+    size_t fi = 0, ci = 0;
+    size_t fn = S.frontier.size(), cn = S.candidates.size();
+    while (S.merged.size() < (size_t) beamSize && (fi < fn || ci < cn)) {
+      if (ci == cn || (fi < fn && elt_less(S.frontier[fi],
+                                           beam_elt{S.candidates[ci].first, S.candidates[ci].second, false})))
+        S.merged.push_back(S.frontier[fi++]);
+      else {
+        S.merged.push_back(beam_elt{S.candidates[ci].first, S.candidates[ci].second, false});
+        ci++;
       }
-      else{f_size = (std::upper_bound(new_frontier.begin(), new_frontier.begin() + f_size,
-				std::pair{0, cut * new_frontier[k].second}, less)
-		- new_frontier.begin());}
     }
-    frontier = parlay::tabulate(f_size, [&] (long i) {return new_frontier[i];});
-    visited.insert(std::upper_bound(visited.begin(), visited.end(), currentPid, less), currentPid);
-    auto uf_iter = std::set_difference(frontier.begin(), frontier.end(),
-				 visited.begin(), visited.end(),
-				 unvisited_frontier.begin(), less);
-    remain = uf_iter - unvisited_frontier.begin();
+    size_t f_size = S.merged.size();
+    if (k > 0 && f_size > k) {
+      float bound = mips ? -cut * S.merged[k].dist : cut * S.merged[k].dist;
+      f_size = std::upper_bound(S.merged.begin(), S.merged.begin() + f_size,
+                                beam_elt{0, bound, false}, elt_less) - S.merged.begin();
+    }
+    S.merged.resize(f_size);
+    std::swap(S.frontier, S.merged);
+
+    next = -1;
+    for (size_t j = 0; j < S.frontier.size(); j++)
+      if (!S.frontier[j].expanded) {next = j; break;}
     num_visited++;
   }
-  return std::make_pair(std::make_pair(frontier, parlay::to_sequence(visited)), dist_cmps);
+  return dist_cmps;
+}
+
+// the search over an in-memory graph
+template <typename T, typename Dist, typename Prefetch>
+size_t beam_search_scratch(
+    Tvec_point<T>* p, parlay::sequence<Tvec_point<T>*>& v,
+    parlay::sequence<Tvec_point<T>*>& starting_points, Dist& dist, Prefetch& prefetch,
+    int beamSize, bool mips, int k, float cut, int limit, beam_scratch& S) {
+  auto start = [&] (size_t i) {return starting_points[i]->id;};
+  auto nbrs = [&] (int a) {return v[a]->out_nbh;};
+  return graph_search_scratch(p->id, starting_points.size(), start, nbrs, dist, prefetch,
+                              beamSize, mips, k, cut, limit, S);
+}
+
+// beam search in which the distance from p to point q is given by dist(q),
+// e.g. an asymmetric distance to a compressed copy of q
+template <typename T, typename Dist, typename Prefetch>
+std::pair<std::pair<parlay::sequence<pid>, parlay::sequence<pid>>, size_t> beam_search_with(
+    Tvec_point<T>* p, parlay::sequence<Tvec_point<T>*>& v,
+    parlay::sequence<Tvec_point<T>*>& starting_points, Dist& dist, Prefetch& prefetch,
+    int beamSize, bool mips, int k=0, float cut=1.14, int limit=-1) {
+  beam_scratch& S = get_beam_scratch();
+  size_t dist_cmps = beam_search_scratch(p, v, starting_points, dist, prefetch, beamSize, mips, k, cut, limit, S);
+  auto less = [&](pid a, pid b) {
+      return a.second < b.second || (a.second == b.second && a.first < b.first); };
+  // the results are copied out sequentially: a fork here could run
+  // another search on this thread, which would overwrite S
+  parlay::sequence<pid> frontier;
+  frontier.reserve(S.frontier.size());
+  for (auto& e : S.frontier) frontier.push_back(pid{e.id, e.dist});
+  std::sort(S.visited.begin(), S.visited.end(), less);
+  parlay::sequence<pid> visited;
+  visited.reserve(S.visited.size());
+  for (pid a : S.visited) visited.push_back(a);
+  return std::make_pair(std::make_pair(frontier, visited), dist_cmps);
+}
+
+template <typename T, typename Dist>
+std::pair<std::pair<parlay::sequence<pid>, parlay::sequence<pid>>, size_t> beam_search_with(
+    Tvec_point<T>* p, parlay::sequence<Tvec_point<T>*>& v,
+    parlay::sequence<Tvec_point<T>*> starting_points, Dist& dist, int beamSize, bool mips, int k=0, float cut=1.14, int limit=-1) {
+  auto no_prefetch = [] (int a) {};
+  return beam_search_with(p, v, starting_points, dist, no_prefetch, beamSize, mips, k, cut, limit);
+}
+
+// searches for q from the given starting points and writes its k nearest
+// neighbors and search statistics into q, reusing this thread's buffers
+template <typename T, typename Dist, typename Prefetch>
+void search_one(Tvec_point<T>* q, parlay::sequence<Tvec_point<T>*>& v,
+                parlay::sequence<Tvec_point<T>*>& starting_points, Dist& dist, Prefetch& prefetch,
+                int beamSizeQ, int k, bool mips, float cut, int limit) {
+  beam_scratch& S = get_beam_scratch();
+  size_t dist_cmps = beam_search_scratch(q, v, starting_points, dist, prefetch, beamSizeQ, mips, k, cut, limit, S);
+  parlay::sequence<int> neighbors = parlay::sequence<int>(k);
+  for (int j = 0; j < k; j++) {
+    neighbors[j] = S.frontier[j].id;
+  }
+  q->ngh = neighbors;
+  q->visited = S.visited.size();
+  q->dist_calls = dist_cmps;
+}
+
+// full-precision distance and prefetch functions for searching for p in v
+template <typename T>
+auto full_distance(Tvec_point<T>* p, parlay::sequence<Tvec_point<T>*>& v, unsigned d, bool mips) {
+  T* vvc = v[0]->coordinates.begin();
+  long stride = v[1]->coordinates.begin() - v[0]->coordinates.begin();
+  T* pc = p->coordinates.begin();
+  return [=] (int q) {
+      if(mips) return mips_distance(vvc + q*stride, pc, d);
+      else return distance(vvc + q*stride, pc, d);
+  };
+}
+
+template <typename T>
+auto full_prefetch(parlay::sequence<Tvec_point<T>*>& v, unsigned d) {
+  T* vvc = v[0]->coordinates.begin();
+  long stride = v[1]->coordinates.begin() - v[0]->coordinates.begin();
+  return [=] (int q) {prefetch_vector(vvc + q*stride, d);};
+}
+
+// updated version by Guy
+template <typename T>
+std::pair<std::pair<parlay::sequence<pid>, parlay::sequence<pid>>, size_t> beam_search(
+    Tvec_point<T>* p, parlay::sequence<Tvec_point<T>*>& v,
+    parlay::sequence<Tvec_point<T>*> starting_points, int beamSize, unsigned d, bool mips, int k=0, float cut=1.14, int limit=-1) {
+  auto dist = full_distance(p, v, d, mips);
+  auto prefetch = full_prefetch(v, d);
+  return beam_search_with(p, v, starting_points, dist, prefetch, beamSize, mips, k, cut, limit);
 }
 
 
@@ -176,20 +356,11 @@ void beamSearchRandom(parlay::sequence<Tvec_point<T>*>& q,
     return dis(r);
   });
 
+  auto prefetch = full_prefetch(v, d);
   parlay::parallel_for(0, q.size(), [&](size_t i) {
-    parlay::sequence<int> neighbors = parlay::sequence<int>(k);
-    size_t index = indices[i];
-    Tvec_point<T>* start = v[index];
-    parlay::sequence<pid> beamElts;
-    parlay::sequence<pid> visitedElts;
-    auto [pairElts, dist_cmps] = beam_search(q[i], v, start, beamSizeQ, d, mips, k, cut, limit);
-    beamElts = pairElts.first;
-    visitedElts = pairElts.second;
-    for (int j = 0; j < k; j++) {
-      neighbors[j] = beamElts[j].first;
-    }
-    q[i]->ngh = neighbors;
-    if (report_stats) {q[i]->visited = visitedElts.size(); q[i]->dist_calls = dist_cmps; }
+    parlay::sequence<Tvec_point<T>*> start_points = {v[indices[i]]};
+    auto dist = full_distance(q[i], v, d, mips);
+    search_one(q[i], v, start_points, dist, prefetch, beamSizeQ, k, mips, cut, limit);
   });
 }
 
@@ -213,17 +384,10 @@ void searchAll(parlay::sequence<Tvec_point<T>*>& q,
               << " same size or smaller than k = " << k << std::endl;
     abort();
   }
+  auto prefetch = full_prefetch(v, d);
   parlay::parallel_for(0, q.size(), [&](size_t i) {
-    parlay::sequence<int> neighbors = parlay::sequence<int>(k);
-    auto [pairElts, dist_cmps] = beam_search(q[i], v, starting_points, beamSizeQ, d, mips, k, cut, limit);
-    auto [beamElts, visitedElts] = pairElts;
-      for (int j = 0; j < k; j++) {
-        neighbors[j] = beamElts[j].first;
-      }
-    q[i]->ngh = neighbors;
-    q[i]->visited = visitedElts.size();
-    q[i]->dist_calls = dist_cmps; 
-
+    auto dist = full_distance(q[i], v, d, mips);
+    search_one(q[i], v, starting_points, dist, prefetch, beamSizeQ, k, mips, cut, limit);
   });
 }
 
@@ -29,35 +29,14 @@
 #include "types.h"
 // #include "parse_results.h"
 #include "beamSearch.h"
+#include "quantize.h"
+#include "filters.h"
 #include "csvfile.h"
 
+// recall r@r of the neighbors stored in q against the groundtruth,
+// counting ties with the r-th groundtruth distance when distances are given
 template<typename T>
-nn_result checkRecall(
-        parlay::sequence<Tvec_point<T>*> &v,
-        parlay::sequence<Tvec_point<T>*> &q,
-        parlay::sequence<ivec_point> groundTruth,
-        int k,
-        int beamQ,
-        float cut,
-        unsigned d,
-        bool random,
-        int limit,
-        int start_point,
-        bool mips) {
-  parlay::internal::timer t;
-  int r = 10;
-  float query_time;
-  if(random){
-    beamSearchRandom(q, v, beamQ, k, d, mips, cut, limit);
-    t.next_time();
-    beamSearchRandom(q, v, beamQ, k, d, mips, cut, limit);
-    query_time = t.next_time();
-  }else{
-    searchAll(q, v, beamQ, k, d, v[start_point], mips, cut, limit);
-    t.next_time();
-    searchAll(q, v, beamQ, k, d, v[start_point], mips, cut, limit);
-    query_time = t.next_time();
-  }
+float nn_recall(parlay::sequence<Tvec_point<T>*> &q, parlay::sequence<ivec_point> &groundTruth, int r) {
   float recall = 0.0;
   bool dists_present = (groundTruth[0].distances.size() != 0);
   if (groundTruth.size() > 0 && !dists_present) {
@@ -96,6 +75,92 @@ nn_result checkRecall(
     }
     recall = static_cast<float>(numCorrect)/static_cast<float>(r*n);
   }
+  return recall;
+}
+
+template<typename T>
+nn_result checkRecall(
+        parlay::sequence<Tvec_point<T>*> &v,
+        parlay::sequence<Tvec_point<T>*> &q,
+        parlay::sequence<ivec_point> groundTruth,
+        int k,
+        int beamQ,
+        float cut,
+        unsigned d,
+        bool random,
+        int limit,
+        int start_point,
+        bool mips) {
+  parlay::internal::timer t;
+  int r = 10;
+  float query_time;
+  if(random){
+    beamSearchRandom(q, v, beamQ, k, d, mips, cut, limit);
+    t.next_time();
+    beamSearchRandom(q, v, beamQ, k, d, mips, cut, limit);
+    query_time = t.next_time();
+  }else{
+    searchAll(q, v, beamQ, k, d, v[start_point], mips, cut, limit);
+    t.next_time();
+    searchAll(q, v, beamQ, k, d, v[start_point], mips, cut, limit);
+    query_time = t.next_time();
+  }
+  float recall = nn_recall(q, groundTruth, r);
+  float QPS = q.size()/query_time;
+  auto stats = query_stats(q);
+  nn_result N(recall, stats, QPS, k, beamQ, cut, q.size());
+  return N;
+}
+
+// same as checkRecall, but searching over the codes held by Qz
+template<typename T, typename Quantizer>
+nn_result checkRecallQuantized(
+        parlay::sequence<Tvec_point<T>*> &v,
+        parlay::sequence<Tvec_point<T>*> &q,
+        parlay::sequence<ivec_point> groundTruth,
+        Quantizer &Qz,
+        int k,
+        int beamQ,
+        float cut,
+        unsigned d,
+        bool random,
+        int limit,
+        int start_point,
+        bool mips) {
+  parlay::internal::timer t;
+  int r = 10;
+  quantizedSearchAll(q, v, Qz, beamQ, k, d, v[start_point], mips, cut, limit, random);
+  t.next_time();
+  quantizedSearchAll(q, v, Qz, beamQ, k, d, v[start_point], mips, cut, limit, random);
+  float query_time = t.next_time();
+  float recall = nn_recall(q, groundTruth, r);
+  float QPS = q.size()/query_time;
+  auto stats = query_stats(q);
+  nn_result N(recall, stats, QPS, k, beamQ, cut, q.size());
+  return N;
+}
+
+// same as checkRecall, but each query only matches the points that
+// share one of its labels
+template<typename T>
+nn_result checkRecallFiltered(
+        parlay::sequence<Tvec_point<T>*> &v,
+        parlay::sequence<Tvec_point<T>*> &q,
+        parlay::sequence<ivec_point> groundTruth,
+        parlay::sequence<int> &label_starts,
+        int k,
+        int beamQ,
+        float cut,
+        unsigned d,
+        int limit,
+        bool mips) {
+  parlay::internal::timer t;
+  int r = 10;
+  filteredSearchAll(q, v, beamQ, k, d, label_starts, mips, cut, limit);
+  t.next_time();
+  filteredSearchAll(q, v, beamQ, k, d, label_starts, mips, cut, limit);
+  float query_time = t.next_time();
+  float recall = nn_recall(q, groundTruth, r);
   float QPS = q.size()/query_time;
   auto stats = query_stats(q);
   nn_result N(recall, stats, QPS, k, beamQ, cut, q.size());
@@ -128,34 +193,72 @@ parlay::sequence<int> calculate_limits(size_t avg_visited){
   return limits;
 }    
 
-template<typename T>
-void search_and_parse(Graph G, parlay::sequence<Tvec_point<T>*> &v, parlay::sequence<Tvec_point<T>*> &q, 
-    parlay::sequence<ivec_point> groundTruth, char* res_file, bool mips, bool random=true, int start_point=0){
-    unsigned d = v[0]->coordinates.size();
-
+// check is called as check(k, Q, cut, limit) and returns an nn_result
+template<typename Check>
+void sweep_and_parse(Graph G, char* res_file, Check check){
     parlay::sequence<nn_result> results;
     std::vector<int> beams = {15, 20, 30, 50, 75, 100, 125, 250, 500};
     std::vector<int> allk = {10, 15, 20, 30, 50, 100};
     std::vector<float> cuts = {1.1, 1.125, 1.15, 1.175, 1.2, 1.25};
     for (float cut : cuts)
       for (float Q : beams) 
-        results.push_back(checkRecall(v, q, groundTruth, 10, Q, cut, d, random, -1, start_point, mips));
+        results.push_back(check(10, Q, cut, -1));
 
     for (float cut : cuts)
       for (int kk : allk)
-        results.push_back(checkRecall(v, q, groundTruth, kk, 500, cut, d, random, -1, start_point, mips));
+        results.push_back(check(kk, 500, cut, -1));
 
     // check "limited accuracy"
     parlay::sequence<int> limits = calculate_limits(results[0].avg_visited);
     for(int l : limits){
-      results.push_back(checkRecall(v, q, groundTruth, 10, 15, 1.14, d, random, l, start_point, mips));
+      results.push_back(check(10, 15, 1.14, l));
     }
 
     // check "best accuracy"
-    results.push_back(checkRecall(v, q, groundTruth, 100, 1000, 10.0, d, random, -1, start_point, mips));
+    results.push_back(check(100, 1000, 10.0, -1));
 
     parlay::sequence<float> buckets = {.1, .15, .2, .25, .3, .35, .4, .45, .5, .55, .6, .65, .7, .73, .75, .77, .8, .83, .85, .87, .9, .93, .95, .97, .99, .995, .999};
     auto [res, ret_buckets] = parse_result(results, buckets);
     if(res_file != NULL) write_to_csv(std::string(res_file), ret_buckets, res, G);
 }
 
+template<typename T, typename Quantizer>
+void quantized_search_and_parse(Graph G, parlay::sequence<Tvec_point<T>*> &v, parlay::sequence<Tvec_point<T>*> &q, 
+    parlay::sequence<ivec_point> groundTruth, char* res_file, bool mips, bool random, int start_point, Quantizer &Qz){
+    unsigned d = v[0]->coordinates.size();
+    parlay::internal::timer t;
+    Qz.build(v);
+    double quant_time = t.next_time();
+    size_t full_bytes = v.size()*d*sizeof(T);
+    std::cout << Qz.name() << " codes built in " << quant_time << " seconds, " << Qz.size_in_bytes()
+      << " bytes (" << ((double) full_bytes)/Qz.size_in_bytes() << "x smaller than full vectors)" << std::endl;
+    G.params += ", " + Qz.name();
+    sweep_and_parse(G, res_file, [&] (int k, int Q, float cut, int limit) {
+      return checkRecallQuantized(v, q, groundTruth, Qz, k, Q, cut, d, random, limit, start_point, mips);});
+}
+
+template<typename T>
+void search_and_parse(Graph G, parlay::sequence<Tvec_point<T>*> &v, parlay::sequence<Tvec_point<T>*> &q, 
+    parlay::sequence<ivec_point> groundTruth, char* res_file, bool mips, bool random=true, int start_point=0){
+    unsigned d = v[0]->coordinates.size();
+    if(filtered_queries()){
+      if(quant_opt.type != "none"){
+        std::cout << "Error: quantized search does not support label filters" << std::endl;
+        abort();
+      }
+      auto label_starts = label_start_points(v, std::max(base_labels.num_labels, query_labels.num_labels));
+      G.params += ", filtered";
+      sweep_and_parse(G, res_file, [&] (int k, int Q, float cut, int limit) {
+        return checkRecallFiltered(v, q, groundTruth, label_starts, k, Q, cut, d, limit, mips);});
+    } else if(quant_opt.type == "sq8"){
+      sq8_quantizer<T> Qz(d, mips);
+      quantized_search_and_parse(G, v, q, groundTruth, res_file, mips, random, start_point, Qz);
+    } else if(quant_opt.type == "pq"){
+      int m = (quant_opt.pq_m > 0) ? quant_opt.pq_m : std::max<int>(1, d/4);
+      pq_quantizer<T> Qz(d, m, mips);
+      quantized_search_and_parse(G, v, q, groundTruth, res_file, mips, random, start_point, Qz);
+    } else{
+      sweep_and_parse(G, res_file, [&] (int k, int Q, float cut, int limit) {
+        return checkRecall(v, q, groundTruth, k, Q, cut, d, random, limit, start_point, mips);});
+    }
+}
@@ -0,0 +1,292 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef DISK_SEARCH
+#define DISK_SEARCH
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/random.h"
+#include "types.h"
+#include "NSGDist.h"
+#include "beamSearch.h"
+#include "quantize.h"
+#include "index_file.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// *************************************************************
+//  Searching an index file that stays on disk.
+//  Only the header, the start points, a bounded cache of hot nodes
+//  (those closest to the start points in the graph) and, if the file
+//  has them, the PQ codes are held in memory.  The graph row of
+//  every other node the search expands is read with pread, and so
+//  are the full vectors used for distances: either for every
+//  distance, or, with PQ codes, only to rerank the final beam.
+// *************************************************************
+
+static_assert(index_pq_centroids == pq_quantizer<float>::K);
+
+template<typename T>
+struct disk_index {
+  int fd;
+  const char* file;
+  index_header H;
+  size_t n;
+  unsigned d;
+  int maxDeg;
+  bool mips;
+  parlay::sequence<int> start_points;
+
+  // the cached nodes, by slot
+  std::unordered_map<int, int> slot;
+  parlay::sequence<int> cached_nbrs;
+  parlay::sequence<T> cached_vecs;
+
+  bool use_pq = false;
+  pq_quantizer<T> PQ;
+
+  disk_index(const char* f) : file(f), PQ(1, 1, false) {
+    fd = open(file, O_RDONLY);
+    if(fd == -1){
+      perror("open");
+      exit(-1);
+    }
+    struct stat sb;
+    if(fstat(fd, &sb) == -1){
+      perror("fstat");
+      exit(-1);
+    }
+    read_at((char*) &H, sizeof(index_header), 0);
+    check_index_header<T>(H, sb.st_size, file);
+    if(H.vector_offset == 0)
+      index_error(file, "has no vectors, write it with -sv 1 to search it from disk");
+    n = H.num_points;
+    d = H.dim;
+    maxDeg = H.max_deg;
+    mips = H.mips;
+    start_points = parlay::sequence<int>(H.num_start_points);
+    read_at((char*) start_points.begin(), sizeof(int)*H.num_start_points, H.start_offset);
+    std::cout << "Opened " << H.algorithm << " index (" << H.params << ") with " << n
+              << " points of dimension " << d << ", max degree " << maxDeg << std::endl;
+  }
+
+  ~disk_index(){close(fd);}
+
+  void read_at(char* buf, size_t bytes, uint64_t offset){
+    while(bytes > 0){
+      ssize_t r = pread(fd, buf, bytes, offset);
+      if(r <= 0){
+        perror("pread");
+        exit(-1);
+      }
+      buf += r; bytes -= r; offset += r;
+    }
+  }
+
+  void read_row(int id, int* buf){
+    read_at((char*) buf, sizeof(int)*maxDeg, H.graph_offset + sizeof(int)*maxDeg*((uint64_t) id));
+  }
+
+  void read_vector(int id, T* buf){
+    read_at((char*) buf, sizeof(T)*d, H.vector_offset + sizeof(T)*d*((uint64_t) id));
+  }
+
+  // loads the PQ section, if there is one, so that the beam can be
+  // searched with in-memory codes
+  bool load_pq(){
+    if(H.pq_offset == 0) return false;
+    int m = H.pq_m;
+    PQ = pq_quantizer<T>(d, m, mips);
+    if(PQ.m != m) index_error(file, "bad PQ subspaces");
+    parlay::sequence<uint32_t> offsets(m+1);
+    read_at((char*) offsets.begin(), sizeof(uint32_t)*(m+1), H.pq_offset);
+    for(int j=0; j<=m; j++){
+      if(offsets[j] > d || (j > 0 && offsets[j] < offsets[j-1])) index_error(file, "bad PQ subspaces");
+      PQ.offsets[j] = offsets[j];
+    }
+    uint64_t offset = H.pq_offset + sizeof(uint32_t)*(m+1);
+    PQ.centroids = parlay::sequence<float>(index_pq_centroids*d);
+    read_at((char*) PQ.centroids.begin(), sizeof(float)*PQ.centroids.size(), offset);
+    offset += sizeof(float)*PQ.centroids.size();
+    PQ.codes = parlay::sequence<uint8_t>(n*m);
+    read_at((char*) PQ.codes.begin(), n*m, offset);
+    use_pq = true;
+    return true;
+  }
+
+  // Caches up to num_nodes nodes in breadth-first order from the start
+  // points (or node 0 if the index has none), since every search
+  // passes through the neighborhood of its starting point.
+  void build_cache(size_t num_nodes){
+    num_nodes = std::min(num_nodes, n);
+    parlay::sequence<int> order;
+    parlay::sequence<int> rows;
+    std::unordered_map<int, int> seen;
+    parlay::sequence<int> frontier = start_points.size() > 0 ? start_points : parlay::sequence<int>(1, 0);
+    for(int a : frontier) seen.emplace(a, 0);
+    while(frontier.size() > 0 && order.size() < num_nodes){
+      size_t take = std::min(frontier.size(), num_nodes - order.size());
+      size_t c = order.size();
+      order.append(frontier.cut(0, take));
+      rows.resize((c+take)*maxDeg);
+      parlay::parallel_for(0, take, [&] (size_t i){read_row(frontier[i], rows.begin() + (c+i)*maxDeg);});
+      parlay::sequence<int> next;
+      for(size_t i=c; i<c+take; i++){
+        for(int j=0; j<maxDeg; j++){
+          int a = rows[i*maxDeg+j];
+          if(a == -1) break;
+          if(seen.emplace(a, 0).second) next.push_back(a);
+        }
+      }
+      frontier = std::move(next);
+    }
+    size_t c = order.size();
+    cached_nbrs = std::move(rows);
+    cached_vecs = parlay::sequence<T>(c*d);
+    parlay::parallel_for(0, c, [&] (size_t i){read_vector(order[i], cached_vecs.begin() + i*d);});
+    slot.clear();
+    for(size_t i=0; i<c; i++) slot.emplace(order[i], i);
+    std::cout << "Cached " << c << " nodes ("
+              << (c*(sizeof(int)*maxDeg + sizeof(T)*d))/(1024*1024) << " MB)" << std::endl;
+  }
+
+  // average and maximum degree, reading the graph a block of rows at a time
+  std::pair<double, int> degree_stats(){
+    size_t block = 1 << 14;
+    size_t total = 0;
+    int max_deg = 0;
+    parlay::sequence<int> rows(block*maxDeg);
+    for(size_t s=0; s<n; s+=block){
+      size_t e = std::min(n, s+block);
+      read_at((char*) rows.begin(), sizeof(int)*(e-s)*maxDeg, H.graph_offset + sizeof(int)*s*maxDeg);
+      auto degrees = parlay::tabulate(e-s, [&] (size_t i){
+        int deg = 0;
+        while(deg < maxDeg && rows[i*maxDeg+deg] != -1) deg++;
+        return deg;
+      });
+      total += parlay::reduce(parlay::map(degrees, [] (int x) {return (size_t) x;}));
+      max_deg = std::max(max_deg, parlay::reduce(degrees, parlay::maxm<int>()));
+    }
+    return std::make_pair(((double) total)/n, max_deg);
+  }
+
+  size_t memory_in_bytes(){
+    size_t cache = cached_nbrs.size()*sizeof(int) + cached_vecs.size()*sizeof(T);
+    return cache + (use_pq ? PQ.size_in_bytes() : 0);
+  }
+};
+
+// per-query counts of what a disk search read
+struct disk_stats {
+  size_t reads = 0;
+  size_t hits = 0;
+};
+
+// Searches for each element of q in I, as searchAll does for an
+// in-memory graph, and records the reads each query made in io.
+template<typename T>
+void diskSearchAll(parlay::sequence<Tvec_point<T>*>& q, disk_index<T>& I,
+                   int beamSizeQ, int k, float cut, int limit,
+                   parlay::sequence<disk_stats>& io) {
+  if ((k + 1) > beamSizeQ) {
+    std::cout << "Error: beam search parameter Q = " << beamSizeQ
+              << " same size or smaller than k = " << k << std::endl;
+    abort();
+  }
+  parlay::random_generator gen;
+  std::uniform_int_distribution<long> dis(0, I.n-1);
+  io = parlay::sequence<disk_stats>(q.size());
+  parlay::parallel_for(0, q.size(), [&](size_t i) {
+    static thread_local std::vector<int> nbr_buf;
+    static thread_local std::vector<T> vec_buf;
+    nbr_buf.resize(I.maxDeg);
+    vec_buf.resize(I.d);
+    disk_stats& s = io[i];
+    T* qc = q[i]->coordinates.begin();
+
+    auto nbrs = [&] (int a) {
+      auto it = I.slot.find(a);
+      if(it != I.slot.end()){
+        s.hits++;
+        int* row = I.cached_nbrs.begin() + ((size_t) it->second)*I.maxDeg;
+        return parlay::make_slice(row, row + I.maxDeg);
+      }
+      s.reads++;
+      I.read_row(a, nbr_buf.data());
+      return parlay::make_slice(nbr_buf.data(), nbr_buf.data() + I.maxDeg);
+    };
+    auto exact = [&] (int a) {
+      T* x;
+      auto it = I.slot.find(a);
+      if(it != I.slot.end()){
+        s.hits++;
+        x = I.cached_vecs.begin() + ((size_t) it->second)*I.d;
+      } else {
+        s.reads++;
+        I.read_vector(a, vec_buf.data());
+        x = vec_buf.data();
+      }
+      return I.mips ? mips_distance(x, qc, I.d) : distance(x, qc, I.d);
+    };
+
+    parlay::sequence<int> starts = I.start_points;
+    if(starts.size() == 0){
+      auto r = gen[i];
+      starts.push_back(dis(r));
+    }
+    auto start = [&] (size_t j) {return starts[j];};
+    beam_scratch& S = get_beam_scratch();
+    size_t dist_cmps;
+    if(I.use_pq){
+      auto table = I.PQ.prepare(qc);
+      auto qdist = [&] (int a) {return I.PQ.distance(table, a);};
+      auto prefetch = [&] (int a) {I.PQ.prefetch(a);};
+      dist_cmps = graph_search_scratch(-1, starts.size(), start, nbrs, qdist, prefetch,
+                                       beamSizeQ, I.mips, k, cut, limit, S);
+      // rerank the beam with the full vectors
+      S.candidates.clear();
+      for (auto& e : S.frontier) S.candidates.push_back(pid{e.id, exact(e.id)});
+      dist_cmps += S.candidates.size();
+      std::sort(S.candidates.begin(), S.candidates.end(), [&] (pid a, pid b) {return a.second < b.second;});
+    } else {
+      auto no_prefetch = [] (int a) {};
+      dist_cmps = graph_search_scratch(-1, starts.size(), start, nbrs, exact, no_prefetch,
+                                       beamSizeQ, I.mips, k, cut, limit, S);
+      S.candidates.clear();
+      for (auto& e : S.frontier) S.candidates.push_back(pid{e.id, e.dist});
+    }
+    parlay::sequence<int> neighbors(k);
+    for (int j = 0; j < k; j++) neighbors[j] = S.candidates[j].first;
+    q[i]->ngh = neighbors;
+    q[i]->visited = S.visited.size();
+    q[i]->dist_calls = dist_cmps;
+  });
+}
+
+#endif
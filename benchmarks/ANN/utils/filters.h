@@ -0,0 +1,333 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FILTERS
+#define FILTERS
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "types.h"
+#include "NSGDist.h"
+#include "beamSearch.h"
+
+// *************************************************************
+//  Labels and filtered search.
+//  Each point may carry a set of integer labels (e.g. a tenant or a
+//  category), and each query carries the labels it is restricted
+//  to.  A point matches a query if they share a label.  Label files
+//  are text with one line per point, holding its labels separated
+//  by commas (an empty line for a point without labels).
+// *************************************************************
+
+// the labels of all points, in compressed rows
+struct label_set {
+  parlay::sequence<size_t> offsets;
+  parlay::sequence<int> labels;
+  int num_labels = 0;
+
+  size_t size(){return offsets.size() == 0 ? 0 : offsets.size()-1;}
+  parlay::slice<int*, int*> of(size_t i){
+    return parlay::make_slice(labels.begin() + offsets[i], labels.begin() + offsets[i+1]);
+  }
+};
+
+// set by the driver from -lb (base) and -lq (query)
+inline label_set base_labels;
+inline label_set query_labels;
+
+inline bool filtered_queries(){return query_labels.size() > 0;}
+
+inline label_set parse_labels(const char* file){
+  std::ifstream in(file);
+  if(!in.is_open()){
+    std::cout << "Error: could not open label file " << file << std::endl;
+    abort();
+  }
+  label_set L;
+  std::vector<size_t> offsets = {0};
+  std::vector<int> labels;
+  std::string line;
+  while(std::getline(in, line)){
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream ls(line);
+    size_t row = labels.size();
+    long l;
+    while(ls >> l){
+      if(l < 0 || l > std::numeric_limits<int>::max()){
+        std::cout << "Error: bad label " << l << " on line " << offsets.size() << " of " << file << std::endl;
+        abort();
+      }
+      labels.push_back((int) l);
+    }
+    if(!ls.eof()){
+      std::cout << "Error: bad label line " << offsets.size() << " of " << file << std::endl;
+      abort();
+    }
+    std::sort(labels.begin() + row, labels.end());
+    labels.erase(std::unique(labels.begin() + row, labels.end()), labels.end());
+    for(size_t j=row; j<labels.size(); j++) L.num_labels = std::max(L.num_labels, labels[j]+1);
+    offsets.push_back(labels.size());
+  }
+  L.offsets = parlay::to_sequence(offsets);
+  L.labels = parlay::to_sequence(labels);
+  std::cout << "Read " << L.size() << " label sets with " << L.labels.size()
+            << " labels from " << file << std::endl;
+  return L;
+}
+
+inline void write_labels(label_set& L, const char* file){
+  std::ofstream out(file);
+  for(size_t i=0; i<L.size(); i++){
+    auto row = L.of(i);
+    for(size_t j=0; j<row.size(); j++) out << (j > 0 ? "," : "") << row[j];
+    out << "\n";
+  }
+}
+
+// gives each point the slice of L holding its labels
+template<typename T>
+void attach_labels(parlay::sequence<Tvec_point<T>*> &v, label_set& L, const char* what){
+  if(L.size() != v.size()){
+    std::cout << "Error: " << L.size() << " " << what << " label sets given for "
+              << v.size() << " " << what << " points" << std::endl;
+    abort();
+  }
+  parlay::parallel_for(0, v.size(), [&] (size_t i){v[i]->labels = L.of(i);});
+}
+
+// true if the sorted label lists a and b intersect
+template<typename Labels>
+inline bool shares_label(Labels& a, Labels& b){
+  size_t i = 0, j = 0;
+  while(i < a.size() && j < b.size()){
+    if(a[i] == b[j]) return true;
+    if(a[i] < b[j]) i++;
+    else j++;
+  }
+  return false;
+}
+
+// true if every label shared by a and b is also a label of c
+template<typename Labels>
+inline bool covers_shared(Labels& c, Labels& a, Labels& b){
+  size_t i = 0, j = 0, l = 0;
+  while(i < a.size() && j < b.size()){
+    if(a[i] < b[j]) i++;
+    else if(b[j] < a[i]) j++;
+    else{
+      while(l < c.size() && c[l] < a[i]) l++;
+      if(l == c.size() || c[l] != a[i]) return false;
+      i++; j++;
+    }
+  }
+  return true;
+}
+
+// the ids of the points with each label
+template<typename T>
+parlay::sequence<parlay::sequence<int>> label_postings(parlay::sequence<Tvec_point<T>*> &v, int num_labels){
+  auto pairs = parlay::flatten(parlay::tabulate(v.size(), [&] (size_t i){
+    return parlay::tabulate(v[i]->labels.size(), [&] (size_t j){
+      return std::make_pair(v[i]->labels[j], v[i]->id);});
+  }));
+  return parlay::group_by_index(pairs, num_labels);
+}
+
+// For each label, the id of the point in v with that label closest to
+// the centroid of the points in v with that label, or -1 if no point
+// has it.  v need not be all the points (e.g. the initial inserts of a
+// build), so points are found by their position in v, not their id.
+// Searches restricted to a label start there.
+template<typename T>
+parlay::sequence<int> label_start_points(parlay::sequence<Tvec_point<T>*> &v, int num_labels){
+  unsigned d = v[0]->coordinates.size();
+  auto pairs = parlay::flatten(parlay::tabulate(v.size(), [&] (size_t i){
+    return parlay::tabulate(v[i]->labels.size(), [&] (size_t j){
+      return std::make_pair(v[i]->labels[j], (int) i);});
+  }));
+  auto postings = parlay::group_by_index(pairs, num_labels);
+  return parlay::tabulate(num_labels, [&] (size_t l) -> int {
+    auto& P = postings[l];
+    if(P.size() == 0) return -1;
+    parlay::sequence<float> centroid(d);
+    parlay::parallel_for(0, d, [&] (size_t j){
+      double sum = 0;
+      for(int a : P) sum += v[a]->coordinates[j];
+      centroid[j] = sum/P.size();
+    });
+    auto dists = parlay::map(P, [&] (int a){return distance(centroid.begin(), v[a]->coordinates.begin(), d);});
+    return v[P[parlay::min_element(dists) - dists.begin()]]->id;
+  }, 1);
+}
+
+// A beam search in which only points for which match(a) is true
+// enter the beam, and so the results.  Points that do not match are
+// still explored, since the path to the matching points may run
+// through them, but only while they are closer than the farthest
+// point of the beam once it is full (or past the cut).  The beam is
+// left in S.frontier and the explored points in S.visited.  Returns
+// the number of distance computations.
+template <typename Start, typename Nbrs, typename Dist, typename Prefetch, typename Match>
+size_t filtered_search_scratch(
+    int self, size_t num_starts, Start& start, Nbrs& nbrs, Dist& dist, Prefetch& prefetch,
+    Match& match, int beamSize, bool mips, int k, float cut, long limit, beam_scratch& S) {
+  if(limit==-1) limit=std::numeric_limits<long>::max();
+  size_t dist_cmps = 0;
+  auto elt_less = [&](const beam_elt& a, const beam_elt& b) {
+      return a.dist < b.dist || (a.dist == b.dist && a.id < b.id); };
+  S.start(beamSize);
+  float bound = std::numeric_limits<float>::max();
+
+  // merges the sorted candidates c into the sorted beam b, keeping
+  // the closest beamSize
+  auto merge = [&] (std::vector<beam_elt>& b, std::vector<pid>& c) {
+    S.merged.clear();
+    size_t bi = 0, ci = 0;
+    while (S.merged.size() < (size_t) beamSize && (bi < b.size() || ci < c.size())) {
+      beam_elt e{0, 0, false};
+      if (ci < c.size()) e = beam_elt{c[ci].first, c[ci].second, false};
+      if (ci == c.size() || (bi < b.size() && elt_less(b[bi], e))) S.merged.push_back(b[bi++]);
+      else {S.merged.push_back(e); ci++;}
+    }
+    std::swap(b, S.merged);
+  };
+  // applies the cut to the beam and drops the points that do not
+  // match and are beyond it
+  auto trim = [&] () {
+    size_t f_size = S.frontier.size();
+    if (f_size == (size_t) beamSize) bound = std::min(bound, S.frontier.back().dist);
+    if (k > 0 && f_size > (size_t) k) {
+      float b = mips ? -cut * S.frontier[k].dist : cut * S.frontier[k].dist;
+      f_size = std::upper_bound(S.frontier.begin(), S.frontier.end(),
+                                beam_elt{std::numeric_limits<int>::max(), b, false}, elt_less) - S.frontier.begin();
+      S.frontier.resize(f_size);
+      bound = std::min(bound, b);
+    }
+    while (S.bridges.size() > 0 && S.bridges.back().dist >= bound) S.bridges.pop_back();
+  };
+
+  S.candidates.clear();
+  S.bridge_candidates.clear();
+  for (size_t i = 0; i < num_starts; i++) {
+    int sp = start(i);
+    if (!S.insert(sp)) continue;
+    pid e{sp, dist(sp)};
+    dist_cmps++;
+    if (match(sp)) S.candidates.push_back(e);
+    else S.bridge_candidates.push_back(e);
+  }
+  auto less = [&](pid a, pid b) {
+      return a.second < b.second || (a.second == b.second && a.first < b.first); };
+  std::sort(S.candidates.begin(), S.candidates.end(), less);
+  std::sort(S.bridge_candidates.begin(), S.bridge_candidates.end(), less);
+  merge(S.frontier, S.candidates);
+  merge(S.bridges, S.bridge_candidates);
+  trim();
+
+  long num_visited = 0;
+  while (num_visited < limit) {
+    // the next point to explore is the closest unexpanded one of
+    // either list
+    beam_elt* current = nullptr;
+    for (auto& e : S.frontier) if (!e.expanded) {current = &e; break;}
+    for (auto& e : S.bridges)
+      if (!e.expanded) {
+        if (current == nullptr || elt_less(e, *current)) current = &e;
+        break;
+      }
+    if (current == nullptr) break;
+    current->expanded = true;
+    S.visited.push_back(pid{current->id, current->dist});
+    auto nbh = nbrs(current->id);
+
+    S.unseen.clear();
+    for (size_t j = 0; j < nbh.size(); j++) {
+      int a = nbh[j];
+      if (a == -1) break;
+      if (a == self || !S.insert(a)) continue;
+      prefetch(a);
+      S.unseen.push_back(a);
+    }
+    S.candidates.clear();
+    S.bridge_candidates.clear();
+    for (int a : S.unseen) {
+      pid e{a, dist(a)};
+      if (match(a)) S.candidates.push_back(e);
+      else if (e.second < bound) S.bridge_candidates.push_back(e);
+    }
+    dist_cmps += S.unseen.size();
+    std::sort(S.candidates.begin(), S.candidates.end(), less);
+    std::sort(S.bridge_candidates.begin(), S.bridge_candidates.end(), less);
+    merge(S.frontier, S.candidates);
+    merge(S.bridges, S.bridge_candidates);
+    trim();
+    num_visited++;
+  }
+  return dist_cmps;
+}
+
+// Searches for each element of q among the points of v that share a
+// label with it, starting from the start points of its labels.
+// Queries whose labels no point has get no neighbors (-1).
+template<typename T>
+void filteredSearchAll(parlay::sequence<Tvec_point<T>*>& q, parlay::sequence<Tvec_point<T>*>& v,
+                       int beamSizeQ, int k, unsigned d, parlay::sequence<int>& label_starts,
+                       bool mips, float cut, int limit) {
+  if ((k + 1) > beamSizeQ) {
+    std::cout << "Error: beam search parameter Q = " << beamSizeQ
+              << " same size or smaller than k = " << k << std::endl;
+    abort();
+  }
+  auto prefetch = full_prefetch(v, d);
+  auto nbrs = [&] (int a) {return v[a]->out_nbh;};
+  parlay::parallel_for(0, q.size(), [&](size_t i) {
+    static thread_local std::vector<int> starts;
+    starts.clear();
+    for (int l : q[i]->labels)
+      if (l < (int) label_starts.size() && label_starts[l] != -1) starts.push_back(label_starts[l]);
+    parlay::sequence<int> neighbors(k, -1);
+    size_t dist_cmps = 0;
+    beam_scratch& S = get_beam_scratch();
+    S.start(beamSizeQ);
+    if (starts.size() > 0) {
+      auto start = [&] (size_t j) {return starts[j];};
+      auto dist = full_distance(q[i], v, d, mips);
+      auto match = [&] (int a) {return shares_label(v[a]->labels, q[i]->labels);};
+      dist_cmps = filtered_search_scratch(-1, starts.size(), start, nbrs, dist, prefetch, match,
+                                          beamSizeQ, mips, k, cut, limit, S);
+      for (size_t j = 0; j < std::min(S.frontier.size(), (size_t) k); j++)
+        neighbors[j] = S.frontier[j].id;
+    }
+    q[i]->ngh = neighbors;
+    q[i]->visited = S.visited.size();
+    q[i]->dist_calls = dist_cmps;
+  });
+}
+
+#endif
@@ -0,0 +1,320 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef INDEX_FILE
+#define INDEX_FILE
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "types.h"
+
+// *************************************************************
+//  Self-describing index files.
+//  The file starts with a fixed header giving the format version,
+//  element type, metric, sizes, how the graph was built, and the
+//  byte offset of every section that follows.  Each section starts
+//  on a page boundary so the file can be mmapped and searched in
+//  place, or read a node at a time by disk_search.h:
+//    start points  num_start_points ints
+//    graph         n rows of max_deg ints, unused slots are -1
+//    vectors       n rows of d elements (optional)
+//    PQ codes      m+1 subspace offsets, K*d centroid floats,
+//                  then n rows of m bytes (optional)
+//  Graph files written before this format (n, maxDeg, graph) are
+//  still read by add_saved_graph in parse_files.h.
+// *************************************************************
+
+constexpr char index_magic[8] = {'P', 'B', 'B', 'S', 'A', 'N', 'N', 'I'};
+constexpr uint32_t index_version = 1;
+constexpr uint64_t index_page = 4096;
+constexpr int index_pq_centroids = 256;
+
+enum index_elt_type : uint32_t {elt_float = 0, elt_uint8 = 1, elt_int8 = 2};
+
+template<typename T>
+uint32_t elt_type_code(){
+  if constexpr (std::is_same_v<T, float>) return elt_float;
+  else if constexpr (std::is_same_v<T, uint8_t>) return elt_uint8;
+  else return elt_int8;
+}
+
+inline const char* elt_type_name(uint32_t t){
+  if(t == elt_float) return "float";
+  if(t == elt_uint8) return "uint8";
+  if(t == elt_int8) return "int8";
+  return "unknown";
+}
+
+struct index_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t elt_type;
+  uint32_t mips;
+  uint64_t num_points;
+  uint32_t dim;
+  uint32_t max_deg;
+  uint32_t num_start_points;
+  uint32_t pq_m;             // 0 if no PQ section
+  uint64_t data_fingerprint; // see data_fingerprint below
+  uint64_t start_offset;
+  uint64_t graph_offset;
+  uint64_t vector_offset;    // 0 if no vector section
+  uint64_t pq_offset;        // 0 if no PQ section
+  uint64_t file_size;
+  char algorithm[32];
+  char params[192];
+  uint64_t checksum;         // of all the bytes above
+};
+
+static_assert(std::is_trivially_copyable_v<index_header>);
+
+// What is known about an index besides its graph.  The ANN
+// implementations fill it in when they build, the loader fills it
+// in from the file, and write_index stores it.  Defined inline since
+// parse_files.h is also used by tools that never build an index.
+struct index_meta {
+  std::string algorithm;
+  std::string params;
+  parlay::sequence<int> start_points;
+  int mips = -1;            // metric of a loaded index, -1 if unknown
+  bool save_vectors = false; // -sv in neighborsTime.C
+  int save_pq_m = 0;         // -spq in neighborsTime.C
+};
+
+inline index_meta index_info;
+
+inline uint64_t page_round(uint64_t x){return (x + index_page - 1)/index_page*index_page;}
+
+inline uint64_t header_checksum(const index_header& H){
+  const unsigned char* c = reinterpret_cast<const unsigned char*>(&H);
+  uint64_t h = 0;
+  for(size_t i=0; i<offsetof(index_header, checksum); i++) h = parlay::hash64(h ^ c[i]);
+  return h;
+}
+
+// A hash of n, d and up to 64 evenly spaced vectors, enough to catch
+// a graph being loaded against the wrong data file without reading
+// all of the data.  coords(i) returns a pointer to the i-th vector.
+template<typename T, typename Coords>
+uint64_t data_fingerprint(size_t n, unsigned d, Coords coords){
+  uint64_t h = parlay::hash64(n) ^ parlay::hash64_2(d);
+  size_t samples = std::min<size_t>(n, 64);
+  for(size_t s=0; s<samples; s++){
+    const unsigned char* c = reinterpret_cast<const unsigned char*>(coords((s*n)/samples));
+    for(size_t b=0; b<d*sizeof(T); b++) h = parlay::hash64(h ^ c[b]);
+  }
+  return h;
+}
+
+inline size_t pq_section_size(size_t n, unsigned d, int m){
+  return sizeof(uint32_t)*(m+1) + sizeof(float)*index_pq_centroids*d + n*m;
+}
+
+inline void pad_to(std::ofstream& writer, uint64_t offset){
+  static const char zeros[index_page] = {};
+  uint64_t pos = writer.tellp();
+  while(pos < offset){
+    uint64_t len = std::min(offset - pos, index_page);
+    writer.write(zeros, len);
+    pos += len;
+  }
+}
+
+struct no_pq {};
+
+// Writes the graph of v (as laid out by add_null_graph or the loader,
+// i.e. n rows of maxDeg ints in one block) and the metadata in meta.
+// The vectors are stored if meta.save_vectors is set, and the codes
+// of pq if it is given (a pq_quantizer from quantize.h).
+template<typename T, typename PQ = no_pq>
+void write_index(parlay::sequence<Tvec_point<T>*> &v, const char* outFile, int maxDeg,
+                 bool mips, index_meta& meta, const PQ* pq = nullptr){
+  size_t n = v.size();
+  unsigned d = v[0]->coordinates.size();
+  std::cout << "Writing index with " << n << " points and max degree " << maxDeg << std::endl;
+
+  index_header H;
+  memset(&H, 0, sizeof(H));
+  memcpy(H.magic, index_magic, sizeof(H.magic));
+  H.version = index_version;
+  H.header_size = sizeof(index_header);
+  H.elt_type = elt_type_code<T>();
+  H.mips = mips;
+  H.num_points = n;
+  H.dim = d;
+  H.max_deg = maxDeg;
+  H.num_start_points = meta.start_points.size();
+  H.data_fingerprint = data_fingerprint<T>(n, d, [&] (size_t i) {return v[i]->coordinates.begin();});
+  strncpy(H.algorithm, meta.algorithm.c_str(), sizeof(H.algorithm)-1);
+  strncpy(H.params, meta.params.c_str(), sizeof(H.params)-1);
+
+  uint64_t offset = page_round(sizeof(index_header));
+  H.start_offset = offset;
+  offset = page_round(offset + sizeof(int)*H.num_start_points);
+  H.graph_offset = offset;
+  offset = page_round(offset + sizeof(int)*n*maxDeg);
+  if(meta.save_vectors){
+    H.vector_offset = offset;
+    offset = page_round(offset + sizeof(T)*n*d);
+  }
+  if constexpr (!std::is_same_v<PQ, no_pq>){
+    if(pq != nullptr){
+      H.pq_m = pq->m;
+      H.pq_offset = offset;
+      offset = page_round(offset + pq_section_size(n, d, pq->m));
+    }
+  }
+  H.file_size = offset;
+  H.checksum = header_checksum(H);
+
+  std::ofstream writer;
+  writer.open(outFile, std::ios::binary | std::ios::out);
+  if(!writer.is_open()){
+    std::cout << "ERROR: could not open " << outFile << " for writing" << std::endl;
+    abort();
+  }
+  writer.write((char*) &H, sizeof(index_header));
+  pad_to(writer, H.start_offset);
+  writer.write((char*) meta.start_points.begin(), sizeof(int)*H.num_start_points);
+  pad_to(writer, H.graph_offset);
+  writer.write((char*) v[0]->out_nbh.begin(), sizeof(int)*n*maxDeg);
+  if(H.vector_offset != 0){
+    // the input vectors need not be contiguous (e.g. .fvecs), so they
+    // are gathered a block at a time
+    pad_to(writer, H.vector_offset);
+    size_t block = 1 << 16;
+    parlay::sequence<T> buffer(block*d);
+    for(size_t s=0; s<n; s+=block){
+      size_t e = std::min(n, s+block);
+      parlay::parallel_for(s, e, [&] (size_t i){
+        std::copy(v[i]->coordinates.begin(), v[i]->coordinates.end(), buffer.begin() + (i-s)*d);
+      });
+      writer.write((char*) buffer.begin(), sizeof(T)*(e-s)*d);
+    }
+  }
+  if constexpr (!std::is_same_v<PQ, no_pq>){
+    if(pq != nullptr){
+      pad_to(writer, H.pq_offset);
+      parlay::sequence<uint32_t> offsets(pq->m+1);
+      for(int j=0; j<=pq->m; j++) offsets[j] = pq->offsets[j];
+      writer.write((char*) offsets.begin(), sizeof(uint32_t)*offsets.size());
+      writer.write((char*) pq->centroids.begin(), sizeof(float)*pq->centroids.size());
+      writer.write((char*) pq->codes.begin(), pq->codes.size());
+    }
+  }
+  pad_to(writer, H.file_size);
+  writer.close();
+}
+
+inline bool is_index_file(const char* ptr, size_t length){
+  return length >= sizeof(index_header) && memcmp(ptr, index_magic, sizeof(index_magic)) == 0;
+}
+
+inline void index_error(const char* file, const std::string& msg){
+  std::cout << "ERROR: index file " << file << ": " << msg << std::endl;
+  abort();
+}
+
+// Checks that the header describes a well-formed file of the given
+// length holding vectors of type T; aborts with a message otherwise.
+template<typename T>
+void check_index_header(const index_header& H, size_t length, const char* file){
+  if(memcmp(H.magic, index_magic, sizeof(index_magic)) != 0) index_error(file, "not an index file");
+  if(H.version != index_version)
+    index_error(file, "format version " + std::to_string(H.version) +
+                ", this build reads version " + std::to_string(index_version));
+  if(H.header_size != sizeof(index_header)) index_error(file, "unexpected header size");
+  if(H.checksum != header_checksum(H)) index_error(file, "header checksum mismatch");
+  if(H.elt_type != elt_type_code<T>())
+    index_error(file, std::string("built for ") + elt_type_name(H.elt_type) +
+                " vectors, but the data is " + elt_type_name(elt_type_code<T>()));
+  if(H.file_size != length)
+    index_error(file, "truncated, expected " + std::to_string(H.file_size) +
+                " bytes but found " + std::to_string(length));
+  auto section_ok = [&] (uint64_t offset, uint64_t bytes) {
+    return offset >= sizeof(index_header) && offset % index_page == 0 && offset + bytes <= length;};
+  if(H.max_deg == 0 || !section_ok(H.start_offset, sizeof(int)*H.num_start_points) ||
+     !section_ok(H.graph_offset, sizeof(int)*H.num_points*H.max_deg) ||
+     (H.vector_offset != 0 && !section_ok(H.vector_offset, sizeof(T)*H.num_points*H.dim)) ||
+     (H.pq_offset != 0 && (H.pq_m == 0 || !section_ok(H.pq_offset, pq_section_size(H.num_points, H.dim, H.pq_m)))))
+    index_error(file, "section table is inconsistent");
+}
+
+// Checks the start points and a sample of the graph rows for ids
+// outside [0, n); the sample keeps loading independent of n.
+inline void check_index_graph(const index_header& H, const int* start_points, const int* graph, const char* file){
+  long n = H.num_points;
+  for(uint32_t i=0; i<H.num_start_points; i++)
+    if(start_points[i] < 0 || start_points[i] >= n) index_error(file, "start point out of range");
+  size_t samples = std::min<size_t>(n, 1000);
+  bool bad = parlay::any_of(parlay::iota(samples), [&] (size_t s){
+    const int* row = graph + ((s*n)/samples)*H.max_deg;
+    for(uint32_t j=0; j<H.max_deg; j++) if(row[j] < -1 || row[j] >= n) return true;
+    return false;
+  });
+  if(bad) index_error(file, "graph contains out of range ids");
+}
+
+// Points the out-neighborhoods of points into the graph section of a
+// mapped index file, after checking that the file matches the data.
+// Fills meta from the header and returns the maximum degree.
+template<typename T>
+int load_index_graph(parlay::sequence<Tvec_point<T>> &points, char* ptr, size_t length,
+                     const char* file, index_meta& meta){
+  index_header H;
+  memcpy(&H, ptr, sizeof(index_header));
+  check_index_header<T>(H, length, file);
+  size_t n = points.size();
+  unsigned d = points[0].coordinates.size();
+  if(H.num_points != n || H.dim != d)
+    index_error(file, "built for " + std::to_string(H.num_points) + " points of dimension " +
+                std::to_string(H.dim) + ", but the data has " + std::to_string(n) +
+                " points of dimension " + std::to_string(d));
+  if(H.data_fingerprint != data_fingerprint<T>(n, d, [&] (size_t i) {return points[i].coordinates.begin();}))
+    index_error(file, "graph file and data file do not match");
+  int* start_points = (int*) (ptr + H.start_offset);
+  int* graph = (int*) (ptr + H.graph_offset);
+  check_index_graph(H, start_points, graph, file);
+
+  int maxDeg = H.max_deg;
+  parlay::parallel_for(0, n, [&] (size_t i){
+    points[i].out_nbh = parlay::make_slice(graph + maxDeg*i, graph + maxDeg*(i+1));
+  });
+  meta.algorithm = std::string(H.algorithm, strnlen(H.algorithm, sizeof(H.algorithm)));
+  meta.params = std::string(H.params, strnlen(H.params, sizeof(H.params)));
+  meta.start_points = parlay::to_sequence(parlay::make_slice(start_points, start_points + H.num_start_points));
+  meta.mips = H.mips;
+  std::cout << "Loaded " << meta.algorithm << " index (" << meta.params << ") with "
+            << n << " points, max degree " << maxDeg << std::endl;
+  return maxDeg;
+}
+
+#endif
@@ -28,6 +28,7 @@
 #include "common/geometryIO.h"
 #include "common/parse_command_line.h"
 #include "types.h"
+#include "index_file.h"
 // #include "common/time_loop.h"
 
 #include <fcntl.h>
@@ -87,6 +88,8 @@ void add_null_graph(parlay::sequence<Tvec_point<T>> &points, int maxDeg){
 template<typename T>
 int add_saved_graph(parlay::sequence<Tvec_point<T>> &points, const char* gFile){
     auto [graphptr, graphlength] = mmapStringFromFile(gFile);
+    if(is_index_file(graphptr, graphlength))
+        return load_index_graph(points, graphptr, graphlength, gFile, index_info);
     int maxDeg = *((int*)(graphptr+4));
     int num_points = *((int*)graphptr);
     if(num_points != points.size()){
@@ -101,22 +104,11 @@ int add_saved_graph(parlay::sequence<Tvec_point<T>> &points, const char* gFile){
     return maxDeg;
 }
 
-//graph file format begins with number of points N, then max degree
-//then N+1 offsets indicating beginning and end of each vector
-//then the IDs in the vector
-//assumes user correctly matches data file and graph file
+//writes v and its graph as an index file (see index_file.h), along
+//with what the algorithm recorded about the build in index_info
 template<typename T>
-void write_graph(parlay::sequence<Tvec_point<T>*> &v, char* outFile, int maxDeg){
-  int n = static_cast<int>(v.size());
-  std::cout << "Writing graph with " << n << " points and max degree " << maxDeg << std::endl;
-  parlay::sequence<int> preamble = {n, maxDeg};
-  int* preamble_data = preamble.begin();
-  int* graph_data = v[0]->out_nbh.begin();
-  std::ofstream writer;
-  writer.open(outFile, std::ios::binary | std::ios::out);
-  writer.write((char *) preamble_data, 2*sizeof(int));
-  writer.write((char *) graph_data, v.size()*maxDeg*sizeof(int));
-  writer.close();
+void write_graph(parlay::sequence<Tvec_point<T>*> &v, char* outFile, int maxDeg, bool mips=false){
+  write_index(v, outFile, maxDeg, mips, index_info);
 }
 
 // *************************************************************
@@ -0,0 +1,339 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef QUANTIZE
+#define QUANTIZE
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/random.h"
+#include "types.h"
+#include "NSGDist.h"
+#include "beamSearch.h"
+
+// *************************************************************
+//  Compressed vector storage for query-time search.
+//  Both quantizers keep one code per point in a single array
+//  and answer distance queries asymmetrically: the query stays
+//  in full precision and is turned into a small table once,
+//  after which each distance is a table lookup over the code.
+//  The full vectors are only touched to rerank the final beam,
+//  and since they are mmapped by parse_files.h, pages that are
+//  never reranked are never read from disk.
+// *************************************************************
+
+// set from the command line (-qt, -pqm) in neighborsTime.C
+struct quant_options {
+  std::string type = "none"; // none, sq8 or pq
+  int pq_m = 0; // number of PQ subspaces, 0 means d/4
+};
+
+extern quant_options quant_opt;
+
+// the number of rows used to compute per-dimension statistics
+// in one sequential block
+constexpr size_t quant_block = 4096;
+
+// Scalar quantizer: each coordinate is stored in one byte using a
+// per-dimension minimum and step, i.e. x ~ lo + step * code.
+template<typename T>
+struct sq8_quantizer {
+  unsigned d;
+  bool mips;
+  parlay::sequence<float> lo;
+  parlay::sequence<float> step;
+  parlay::sequence<uint8_t> codes;
+  using query_table = parlay::sequence<float>;
+
+  sq8_quantizer(unsigned dim, bool m) : d(dim), mips(m) {}
+
+  std::string name() {return "SQ8";}
+
+  void train(parlay::sequence<Tvec_point<T>*> &v){
+    size_t n = v.size();
+    size_t num_blocks = (n + quant_block - 1)/quant_block;
+    // per-block minima and maxima, each block scanned row by row
+    auto block_bounds = parlay::tabulate(num_blocks, [&] (size_t b){
+      parlay::sequence<float> bounds(2*d);
+      for(unsigned j=0; j<d; j++){
+        bounds[j] = std::numeric_limits<float>::max();
+        bounds[d+j] = std::numeric_limits<float>::lowest();
+      }
+      size_t end = std::min(n, (b+1)*quant_block);
+      for(size_t i=b*quant_block; i<end; i++){
+        for(unsigned j=0; j<d; j++){
+          float x = static_cast<float>(v[i]->coordinates[j]);
+          bounds[j] = std::min(bounds[j], x);
+          bounds[d+j] = std::max(bounds[d+j], x);
+        }
+      }
+      return bounds;
+    }, 1);
+    lo = parlay::sequence<float>(d);
+    step = parlay::sequence<float>(d);
+    parlay::parallel_for(0, d, [&] (size_t j){
+      float mn = std::numeric_limits<float>::max();
+      float mx = std::numeric_limits<float>::lowest();
+      for(size_t b=0; b<num_blocks; b++){
+        mn = std::min(mn, block_bounds[b][j]);
+        mx = std::max(mx, block_bounds[b][d+j]);
+      }
+      lo[j] = mn;
+      step[j] = (mx > mn) ? (mx - mn)/255 : 1;
+    });
+  }
+
+  void encode(parlay::sequence<Tvec_point<T>*> &v){
+    size_t n = v.size();
+    codes = parlay::sequence<uint8_t>(n*d);
+    parlay::parallel_for(0, n, [&] (size_t i){
+      uint8_t* c = codes.begin() + i*d;
+      for(unsigned j=0; j<d; j++){
+        float x = (static_cast<float>(v[i]->coordinates[j]) - lo[j])/step[j];
+        c[j] = static_cast<uint8_t>(std::clamp(std::round(x), 0.0f, 255.0f));
+      }
+    });
+  }
+
+  void build(parlay::sequence<Tvec_point<T>*> &v){
+    train(v);
+    encode(v);
+  }
+
+  size_t size_in_bytes(){return codes.size() + 2*d*sizeof(float);}
+
+  // for L2 the table holds the query in code units followed by step^2,
+  // for MIPS it holds -q*step followed by the constant term -q.lo
+  query_table prepare(T* q){
+    query_table table(2*d+1);
+    float bias = 0;
+    for(unsigned j=0; j<d; j++){
+      float qj = static_cast<float>(q[j]);
+      if(mips){
+        table[j] = -qj*step[j];
+        bias -= qj*lo[j];
+      } else{
+        table[j] = (qj - lo[j])/step[j];
+        table[d+j] = step[j]*step[j];
+      }
+    }
+    table[2*d] = bias;
+    return table;
+  }
+
+  void prefetch(int id){prefetch_vector(codes.begin() + ((size_t) id)*d, d);}
+
+  float distance(query_table &table, int id){
+    const uint8_t* c = codes.begin() + ((size_t) id)*d;
+    float result = 0;
+    if(mips){
+      for(unsigned j=0; j<d; j++) result += table[j]*c[j];
+      return result + table[2*d];
+    }
+    for(unsigned j=0; j<d; j++){
+      float diff = table[j] - c[j];
+      result += table[d+j]*diff*diff;
+    }
+    return result;
+  }
+};
+
+// Product quantizer: the dimensions are split into m subspaces, each
+// with its own 256-entry codebook trained by k-means, so a vector is
+// stored in m bytes.
+template<typename T>
+struct pq_quantizer {
+  static constexpr int K = 256;
+  unsigned d;
+  int m;
+  bool mips;
+  int iters;
+  size_t sample_size;
+  parlay::sequence<unsigned> offsets; // subspace j covers dimensions [offsets[j], offsets[j+1])
+  parlay::sequence<float> centroids; // codebook j is K*(offsets[j+1]-offsets[j]) floats starting at K*offsets[j]
+  parlay::sequence<uint8_t> codes;
+  using query_table = parlay::sequence<float>;
+
+  pq_quantizer(unsigned dim, int subspaces, bool mp, int it=10, size_t ss=65536) :
+    d(dim), m(std::clamp<int>(subspaces, 1, dim)), mips(mp), iters(it), sample_size(ss) {
+    offsets = parlay::tabulate(m+1, [&] (size_t j) {return static_cast<unsigned>((j*d)/m);});
+  }
+
+  std::string name() {return "PQ" + std::to_string(m);}
+
+  float* codebook(int j){return centroids.begin() + K*offsets[j];}
+
+  // index of the codebook entry closest to x in subspace j
+  uint8_t nearest(int j, const float* x){
+    unsigned ds = offsets[j+1] - offsets[j];
+    float* cb = codebook(j);
+    int best = 0;
+    float best_dist = std::numeric_limits<float>::max();
+    for(int c=0; c<K; c++){
+      float dist = 0;
+      for(unsigned t=0; t<ds; t++){
+        float diff = x[t] - cb[c*ds+t];
+        dist += diff*diff;
+      }
+      if(dist < best_dist){best_dist = dist; best = c;}
+    }
+    return static_cast<uint8_t>(best);
+  }
+
+  // Lloyd's k-means per subspace on a random sample of the points
+  void train(parlay::sequence<Tvec_point<T>*> &v){
+    size_t n = v.size();
+    size_t s = std::min(n, sample_size);
+    parlay::random_generator gen;
+    std::uniform_int_distribution<long> dis(0, n-1);
+    auto sample_ids = parlay::tabulate(s, [&] (size_t i) {
+      auto r = gen[i];
+      return dis(r);
+    });
+    parlay::sequence<float> sample(s*d);
+    parlay::parallel_for(0, s, [&] (size_t i){
+      for(unsigned j=0; j<d; j++) sample[i*d+j] = static_cast<float>(v[sample_ids[i]]->coordinates[j]);
+    });
+    centroids = parlay::sequence<float>(K*d);
+    parlay::parallel_for(0, m, [&] (size_t j){
+      unsigned off = offsets[j];
+      unsigned ds = offsets[j+1] - off;
+      float* cb = codebook(j);
+      auto sub = [&] (size_t i) {return sample.begin() + i*d + off;};
+      for(int c=0; c<K; c++)
+        for(unsigned t=0; t<ds; t++) cb[c*ds+t] = sub(c % s)[t];
+      for(int it=0; it<iters; it++){
+        auto assign = parlay::tabulate(s, [&] (size_t i) {return nearest(j, sub(i));});
+        parlay::sequence<double> sums(K*ds, 0.0);
+        parlay::sequence<size_t> counts(K, 0);
+        for(size_t i=0; i<s; i++){
+          counts[assign[i]]++;
+          for(unsigned t=0; t<ds; t++) sums[assign[i]*ds+t] += sub(i)[t];
+        }
+        for(int c=0; c<K; c++){
+          // reseed empty clusters with a sample point
+          if(counts[c] == 0){
+            size_t r = parlay::hash64(it*K + c) % s;
+            for(unsigned t=0; t<ds; t++) cb[c*ds+t] = sub(r)[t];
+          } else{
+            for(unsigned t=0; t<ds; t++) cb[c*ds+t] = static_cast<float>(sums[c*ds+t]/counts[c]);
+          }
+        }
+      }
+    }, 1);
+  }
+
+  void encode(parlay::sequence<Tvec_point<T>*> &v){
+    size_t n = v.size();
+    codes = parlay::sequence<uint8_t>(n*m);
+    parlay::parallel_for(0, n, [&] (size_t i){
+      parlay::sequence<float> x(d);
+      for(unsigned j=0; j<d; j++) x[j] = static_cast<float>(v[i]->coordinates[j]);
+      for(int j=0; j<m; j++) codes[i*m+j] = nearest(j, x.begin() + offsets[j]);
+    });
+  }
+
+  void build(parlay::sequence<Tvec_point<T>*> &v){
+    train(v);
+    encode(v);
+  }
+
+  size_t size_in_bytes(){return codes.size() + centroids.size()*sizeof(float);}
+
+  // table[j*K+c] is the distance from the query to codebook entry c
+  // restricted to subspace j
+  query_table prepare(T* q){
+    query_table table(m*K);
+    for(int j=0; j<m; j++){
+      unsigned off = offsets[j];
+      unsigned ds = offsets[j+1] - off;
+      float* cb = codebook(j);
+      for(int c=0; c<K; c++){
+        float result = 0;
+        for(unsigned t=0; t<ds; t++){
+          float qt = static_cast<float>(q[off+t]);
+          if(mips) result -= qt*cb[c*ds+t];
+          else result += (qt - cb[c*ds+t])*(qt - cb[c*ds+t]);
+        }
+        table[j*K+c] = result;
+      }
+    }
+    return table;
+  }
+
+  void prefetch(int id){prefetch_vector(codes.begin() + ((size_t) id)*m, m);}
+
+  float distance(query_table &table, int id){
+    const uint8_t* c = codes.begin() + ((size_t) id)*m;
+    float result = 0;
+    for(int j=0; j<m; j++) result += table[j*K + c[j]];
+    return result;
+  }
+};
+
+// beam search over the compressed codes, then rerank the final
+// beam with full-precision distances and keep the top k
+template<typename T, typename Quantizer>
+void quantizedSearchAll(parlay::sequence<Tvec_point<T>*>& q,
+                        parlay::sequence<Tvec_point<T>*>& v, Quantizer& Qz,
+                        int beamSizeQ, int k, unsigned d, Tvec_point<T>* starting_point,
+                        bool mips, float cut, int limit, bool random) {
+  if ((k + 1) > beamSizeQ) {
+    std::cout << "Error: beam search parameter Q = " << beamSizeQ
+              << " same size or smaller than k = " << k << std::endl;
+    abort();
+  }
+  size_t n = v.size();
+  parlay::random_generator gen;
+  std::uniform_int_distribution<long> dis(0, n-1);
+  auto indices = parlay::tabulate(q.size(), [&](size_t i) {
+    auto r = gen[i];
+    return dis(r);
+  });
+
+  auto prefetch = [&] (int j) {Qz.prefetch(j);};
+  parlay::parallel_for(0, q.size(), [&](size_t i) {
+    auto table = Qz.prepare(q[i]->coordinates.begin());
+    auto qdist = [&] (int j) {return Qz.distance(table, j);};
+    parlay::sequence<Tvec_point<T>*> start_points = {random ? v[indices[i]] : starting_point};
+    beam_scratch& S = get_beam_scratch();
+    size_t dist_cmps = beam_search_scratch(q[i], v, start_points, qdist, prefetch, beamSizeQ, mips, k, cut, limit, S);
+    // the candidates are reranked in the scratch candidate buffer
+    auto exact = full_distance(q[i], v, d, mips);
+    auto full_prefetch_one = full_prefetch(v, d);
+    S.candidates.clear();
+    for (auto& e : S.frontier) full_prefetch_one(e.id);
+    for (auto& e : S.frontier) S.candidates.push_back(pid{e.id, exact(e.id)});
+    std::sort(S.candidates.begin(), S.candidates.end(), [&] (pid a, pid b) {return a.second < b.second;});
+    parlay::sequence<int> neighbors(k);
+    for (int j = 0; j < k; j++) neighbors[j] = S.candidates[j].first;
+    q[i]->ngh = neighbors;
+    q[i]->visited = S.visited.size();
+    q[i]->dist_calls = dist_cmps + S.candidates.size();
+  });
+}
+
+#endif
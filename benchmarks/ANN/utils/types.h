@@ -38,10 +38,12 @@ struct Tvec_point {
   parlay::slice<T*, T*> coordinates;
   parlay::slice<int*, int*> out_nbh; 
   parlay::slice<int*, int*> new_nbh; 
+  parlay::slice<int*, int*> labels; // sorted; empty if the data has no labels
   Tvec_point() :
     coordinates(parlay::make_slice<T*, T*>(nullptr, nullptr)),
     out_nbh(parlay::make_slice<int*, int*>(nullptr, nullptr)),
-    new_nbh(parlay::make_slice<int*, int*>(nullptr, nullptr)) {}
+    new_nbh(parlay::make_slice<int*, int*>(nullptr, nullptr)),
+    labels(parlay::make_slice<int*, int*>(nullptr, nullptr)) {}
   parlay::sequence<int> ngh = parlay::sequence<int>();
 };
 
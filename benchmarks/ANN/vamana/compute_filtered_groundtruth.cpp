@@ -0,0 +1,134 @@
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/io.h"
+#include "../utils/types.h"
+#include "../utils/NSGDist.h"
+#include "../utils/parse_files.h"
+#include "../utils/filters.h"
+
+using pid = std::pair<int, float>;
+
+// *************************************************************
+//  The groundtruth for filtered search: the k nearest neighbors of
+//  each query among the base points that share a label with it.
+//  Only those points are scanned, using the points of each label.
+//  Queries with fewer than k matching points are padded with id -1
+//  (and the largest float as distance), which is also what the
+//  filtered search reports when it finds no more matches.
+// *************************************************************
+
+template<typename T>
+parlay::sequence<parlay::sequence<pid>> compute_filtered_groundtruth(parlay::sequence<Tvec_point<T>> &B,
+  parlay::sequence<Tvec_point<T>> &Q, label_set &BL, label_set &QL, int k, bool mips){
+  auto v = parlay::tabulate(B.size(), [&] (size_t i) -> Tvec_point<T>* {return &B[i];});
+  auto q = parlay::tabulate(Q.size(), [&] (size_t i) -> Tvec_point<T>* {return &Q[i];});
+  attach_labels(v, BL, "base");
+  attach_labels(q, QL, "query");
+  int num_labels = std::max(BL.num_labels, QL.num_labels);
+  auto postings = label_postings(v, num_labels);
+  unsigned d = B[0].coordinates.size();
+  auto less = [&] (pid a, pid b) {return a.second < b.second || (a.second == b.second && a.first < b.first);};
+  auto answers = parlay::tabulate(q.size(), [&] (size_t i){
+    parlay::sequence<int> candidates;
+    for(int l : q[i]->labels) candidates.append(postings[l]);
+    if(q[i]->labels.size() > 1) candidates = parlay::remove_duplicates(candidates);
+    auto dists = parlay::map(candidates, [&] (int j){
+      float dist = mips ? mips_distance(q[i]->coordinates.begin(), v[j]->coordinates.begin(), d)
+                        : distance(q[i]->coordinates.begin(), v[j]->coordinates.begin(), d);
+      return pid{j, dist};
+    });
+    size_t m = std::min(dists.size(), (size_t) k);
+    std::partial_sort(dists.begin(), dists.begin() + m, dists.end(), less);
+    parlay::sequence<pid> topk(dists.begin(), dists.begin() + m);
+    while((int) topk.size() < k) topk.push_back(pid{-1, std::numeric_limits<float>::max()});
+    return topk;
+  }, 1);
+  auto sizes = parlay::map(q, [&] (Tvec_point<T>* p) {
+    size_t c = 0;
+    for(int l : p->labels) c += postings[l].size();
+    return c;});
+  std::cout << "Done computing groundtruth; on average " << ((double) parlay::reduce(sizes))/q.size()
+            << " candidate points per query" << std::endl;
+  return answers;
+}
+
+void write_ivecs(parlay::sequence<parlay::sequence<pid>> &result, const std::string outFile, int k){
+  size_t n = result.size();
+  auto vects = parlay::tabulate(n, [&] (size_t i){
+    parlay::sequence<int> data;
+    data.push_back(k);
+    for(int j=0; j<k; j++) data.push_back(result[i][j].first);
+    return data;
+  });
+  parlay::sequence<int> to_write = parlay::flatten(vects);
+  std::ofstream writer(outFile, std::ios::binary | std::ios::out);
+  writer.write((char *) to_write.begin(), n * (k+1) * sizeof(int));
+}
+
+void write_ibin(parlay::sequence<parlay::sequence<pid>> &result, const std::string outFile, int k){
+  size_t n = result.size();
+  int preamble[2] = {static_cast<int>(n), k};
+  auto ids = parlay::flatten(parlay::map(result, [&] (auto& r) {
+    return parlay::map(r, [] (pid a) {return a.first;});}));
+  auto dists = parlay::flatten(parlay::map(result, [&] (auto& r) {
+    return parlay::map(r, [] (pid a) {return a.second;});}));
+  std::ofstream writer(outFile, std::ios::binary | std::ios::out);
+  writer.write((char *) preamble, 2*sizeof(int));
+  writer.write((char *) ids.begin(), n * k * sizeof(int));
+  writer.write((char *) dists.begin(), n * k * sizeof(float));
+}
+
+template<typename T>
+void run(std::pair<int, parlay::sequence<Tvec_point<T>>> base, std::pair<int, parlay::sequence<Tvec_point<T>>> query,
+         label_set &BL, label_set &QL, int k, bool mips, std::string ft, char* oFile){
+  auto& B = base.second;
+  auto& Q = query.second;
+  std::cout << "Base file size " << B.size() << std::endl;
+  std::cout << "Query file size " << Q.size() << std::endl;
+  auto answers = compute_filtered_groundtruth<T>(B, Q, BL, QL, k, mips);
+  std::cout << "Writing groundtruth for " << answers.size() << " queries" << std::endl;
+  if(ft == "vec") write_ivecs(answers, std::string(oFile), k);
+  else write_ibin(answers, std::string(oFile), k);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 10) {
+    std::cout << "usage: compute_filtered_groundtruth <base> <query> <baseLabels> <queryLabels> <filetype> <vectype> <k> <mips> <oFile>" << std::endl;
+    return 1;
+  }
+  int k = std::atoi(argv[7]);
+  bool mips = (std::atoi(argv[8]) == 1);
+  std::string ft = std::string(argv[5]);
+  std::string tp = std::string(argv[6]);
+  char* oFile = argv[9];
+
+  if((ft != "bin") && (ft != "vec")){
+    std::cout << "Error: file type not specified correctly, specify bin or vec" << std::endl;
+    abort();
+  }
+  if((tp != "uint8") && (tp != "int8") && (tp != "float")){
+    std::cout << "Error: vector type not specified correctly, specify int8, uint8, or float" << std::endl;
+    abort();
+  }
+  if((ft == "vec") && (tp == "int8")){
+    std::cout << "Error: incompatible file and vector types" << std::endl;
+    abort();
+  }
+
+  label_set BL = parse_labels(argv[3]);
+  label_set QL = parse_labels(argv[4]);
+  std::cout << "Computing the " << k << " nearest matching neighbors" << std::endl;
+  if(ft == "vec"){
+    if(tp == "float") run<float>(parse_fvecs(argv[1], NULL, 0), parse_fvecs(argv[2], NULL, 0), BL, QL, k, mips, ft, oFile);
+    else run<uint8_t>(parse_bvecs(argv[1], NULL, 0), parse_bvecs(argv[2], NULL, 0), BL, QL, k, mips, ft, oFile);
+  } else {
+    if(tp == "float") run<float>(parse_fbin(argv[1], NULL, 0), parse_fbin(argv[2], NULL, 0), BL, QL, k, mips, ft, oFile);
+    else if(tp == "uint8") run<uint8_t>(parse_uint8bin(argv[1], NULL, 0), parse_uint8bin(argv[2], NULL, 0), BL, QL, k, mips, ft, oFile);
+    else run<int8_t>(parse_int8bin(argv[1], NULL, 0), parse_int8bin(argv[2], NULL, 0), BL, QL, k, mips, ft, oFile);
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/random.h"
+#include "common/parse_command_line.h"
+#include "../utils/filters.h"
+
+// *************************************************************
+//  Writes a label file for filtered search (see filters.h): each
+//  of n points gets -per distinct labels out of -labels, drawn
+//  either uniformly or from a Zipf distribution with exponent -s, in
+//  which label l has probability proportional to 1/(l+1)^s.  Query
+//  labels are generated the same way, usually with -per 1 and a
+//  different -seed.
+// *************************************************************
+
+int main(int argc, char* argv[]) {
+  commandLine P(argc,argv,
+    "-n <points> [-labels <numLabels>] [-per <labelsPerPoint>] [-dist <uniform|zipf>] [-s <exponent>] [-seed <seed>] <oFile>");
+  char* oFile = P.getArgument(0);
+  long n = P.getOptionLongValue("-n", 0);
+  if(n < 1) P.badArgument();
+  int num_labels = P.getOptionIntValue("-labels", 10);
+  if(num_labels < 1) P.badArgument();
+  int per = P.getOptionIntValue("-per", 1);
+  if(per < 1 || per > num_labels) P.badArgument();
+  std::string dist = std::string(P.getOptionValue("-dist", "uniform"));
+  if(dist != "uniform" && dist != "zipf"){
+    std::cout << "Error: label distribution not specified correctly, specify uniform or zipf" << std::endl;
+    abort();
+  }
+  double s = P.getOptionDoubleValue("-s", 1.0);
+  long seed = P.getOptionLongValue("-seed", 0);
+
+  // the cumulative distribution of the labels
+  parlay::sequence<double> cdf(num_labels);
+  double total = 0;
+  for(int l=0; l<num_labels; l++){
+    total += (dist == "zipf") ? 1.0/std::pow(l+1, s) : 1.0;
+    cdf[l] = total;
+  }
+
+  parlay::random_generator gen(seed);
+  std::uniform_real_distribution<double> dis(0, total);
+  auto rows = parlay::tabulate(n, [&] (size_t i){
+    auto r = gen[i];
+    parlay::sequence<int> labels;
+    while((int) labels.size() < per){
+      int l = std::min<int>(std::upper_bound(cdf.begin(), cdf.end(), dis(r)) - cdf.begin(), num_labels-1);
+      if(std::find(labels.begin(), labels.end(), l) == labels.end()) labels.push_back(l);
+    }
+    std::sort(labels.begin(), labels.end());
+    return labels;
+  });
+
+  label_set L;
+  auto [offsets, total_labels] = parlay::scan(parlay::map(rows, [] (auto& r) {return r.size();}));
+  L.offsets = std::move(offsets);
+  L.offsets.push_back(total_labels);
+  L.labels = parlay::flatten(rows);
+  L.num_labels = num_labels;
+  write_labels(L, oFile);
+
+  auto postings = parlay::histogram_by_index(L.labels, num_labels);
+  std::cout << "Wrote " << per << " label(s) for each of " << n << " points to " << oFile
+            << "; most common label on " << parlay::reduce(postings, parlay::maxm<size_t>())
+            << " points, least common on " << parlay::reduce(postings, parlay::minm<size_t>()) << std::endl;
+  return 0;
+}
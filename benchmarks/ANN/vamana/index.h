@@ -25,9 +25,13 @@
 #include "parlay/primitives.h"
 #include "parlay/random.h"
 #include "../utils/indexTools.h"
+#include "../utils/beamSearch.h"
+#include "../utils/filters.h"
 #include "common/geometry.h"
+#include <atomic>
 #include <random>
 #include <set>
+#include <vector>
 #include <math.h>
 
 extern bool report_stats;
@@ -40,7 +44,19 @@ struct knn_index{
 	double r2_alpha; //alpha parameter for round 2 of robustPrune
 	unsigned d;
 	bool mips;
-	std::set<int> delete_set; 
+	//tombstones, sized when the index is built or loaded.  Searches
+	//read them while updates (batch_insert, lazy_delete and the
+	//consolidations) run, so they are atomic.  Updates must not overlap
+	//each other, since pending is not locked.
+	std::vector<std::atomic<bool>> deleted;
+	//deleted points whose neighborhoods have not been repaired yet
+	parlay::sequence<int> pending;
+	std::atomic<size_t> num_deleted{0};
+	//label-aware construction (Filtered-DiskANN): inserts search from
+	//the start points of their labels and prune by label coverage
+	bool filtered = false;
+	int num_labels = 0;
+	parlay::sequence<int> label_starts;
 	using tvec_point = Tvec_point<T>;
 	using fvec_point = Tvec_point<float>;
 	tvec_point* medoid;
@@ -116,6 +132,34 @@ struct knn_index{
 
 	int get_medoid(){return medoid->id;}
 
+	bool is_deleted(int p){
+		return deleted.size() > 0 && deleted[p].load(std::memory_order_relaxed);
+	}
+
+	//must be called before any searches start, since it replaces the
+	//tombstones they read
+	void init_tombstones(size_t n){
+		deleted = std::vector<std::atomic<bool>>(n);
+		pending.clear();
+		num_deleted = 0;
+	}
+
+	//uses a medoid recorded with a saved index instead of recomputing it
+	void set_medoid(tvec_point* m){medoid = m;}
+
+	//builds the graph using the labels attached to the points
+	void enable_filters(int labels){
+		filtered = true;
+		num_labels = labels;
+	}
+
+	//the start points are taken from the initial inserts, so they are in
+	//the graph and are not inserted again later
+	void find_label_starts(parlay::sequence<Tvec_point<T>*> &initial){
+		label_starts = label_start_points(initial, num_labels);
+		std::cout << "Label start points: " << parlay::count_if(label_starts, [] (int s) {return s != -1;}) << std::endl;
+	}
+
 	void print_set(std::set<int> myset){
 		std::cout << "[";
 		for (std::set<int>::iterator it=myset.begin(); it!=myset.end(); ++it){
@@ -125,11 +169,13 @@ struct knn_index{
 	}
 
 	//robustPrune routine as found in DiskANN paper, with the exception that the new candidate set
-	//is added to the field new_nbhs instead of directly replacing the out_nbh of p
+	//is added to the field new_nbhs instead of directly replacing the out_nbh of p; with filters,
+	//p_star only prunes p_prime if it has every label p and p_prime share
 	void robustPrune(tvec_point* p, parlay::sequence<pid> candidates, parlay::sequence<tvec_point*> &v, double alpha, bool add = true) {
     // add out neighbors of p to the candidate set.
     if(add){
     	for (size_t i=0; i<size_of(p->out_nbh); i++) {
+				if(is_deleted(p->out_nbh[i])) continue;
 				candidates.push_back(std::make_pair(p->out_nbh[i],
 					Distance(v[p->out_nbh[i]]->coordinates.begin(), p->coordinates.begin(), d)));
 			}
@@ -159,7 +205,8 @@ struct knn_index{
         if (p_prime != -1) {
           float dist_starprime = Distance(v[p_star]->coordinates.begin(), v[p_prime]->coordinates.begin(), d);
           float dist_pprime = candidates[i].second;
-          if (alpha * dist_starprime <= dist_pprime) {
+          if (alpha * dist_starprime <= dist_pprime &&
+              (!filtered || covers_shared(v[p_star]->labels, p->labels, v[p_prime]->labels))) {
             candidates[i].first = -1;
           }
         }
@@ -183,7 +230,12 @@ struct knn_index{
 	void build_index(parlay::sequence<Tvec_point<T>*> &v, parlay::sequence<int> inserts, bool two_pass=false){
 		std::cout << "Mips: " << mips << std::endl;
 		clear(v);
-		find_approx_medoid(v);
+		init_tombstones(v.size());
+		//the medoid is taken over the inserted points only, since the
+		//others may be inserted later or never
+		auto initial = parlay::tabulate(inserts.size(), [&] (size_t i) {return v[inserts[i]];});
+		find_approx_medoid(initial);
+		if(filtered) find_label_starts(initial);
 		if(two_pass){
 		  std::cout << "Starting first pass" << std::endl; 
 		  batch_insert(inserts, v, true, 1.0, 2, .02, two_pass);
@@ -192,76 +244,96 @@ struct knn_index{
 		batch_insert(inserts, v, true, r2_alpha, 2, .02,  two_pass);
 	}
 
+	//marks points as deleted; they are no longer returned by searches
+	//or linked to by inserts, but stay in the graph (and can still be
+	//traversed) until their neighborhoods are repaired
 	void lazy_delete(parlay::sequence<int> deletes, parlay::sequence<Tvec_point<T>*> &v){
+		if(deleted.size() != v.size()){
+			std::cout << "ERROR: lazy_delete called before the index was built or loaded" << std::endl;
+			abort();
+		}
 		for(int p : deletes){
-			if(p < 0 || p > (int) v.size() ){
+			if(p < 0 || p >= (int) v.size() ){
 				std::cout << "ERROR: invalid point " << p << " given to lazy_delete" << std::endl; 
 				abort();
 			}
-			if(p != medoid->id) delete_set.insert(p);
-			else std::cout << "Deleting medoid not permitted; continuing" << std::endl; 
+			if(p == medoid->id){
+				std::cout << "Deleting medoid not permitted; continuing" << std::endl; 
+				continue;
+			}
+			if(!deleted[p].exchange(true)) {pending.push_back(p); num_deleted++;}
 		} 
 	}
 
 	void lazy_delete(int p, parlay::sequence<Tvec_point<T>*> &v){
-		if(p < 0 || p > (int) v.size()){
-			std::cout << "ERROR: invalid point " << p << " given to lazy_delete" << std::endl; 
-			abort();
-		}
-		if(p == medoid->id){
-			std::cout << "Deleting medoid not permitted; continuing" << std::endl; 
-			return;
-		} 
-		delete_set.insert(p);
+		parlay::sequence<int> deletes = {p};
+		lazy_delete(deletes, v);
 	}
 
-	void consolidate_deletes(parlay::sequence<Tvec_point<T>*> &v){
-		//clear deleted neighbors out of delete set for preprocessing
-
-		parlay::parallel_for(0, v.size(), [&] (size_t i){
-			if(delete_set.find(i) != delete_set.end()){
-				parlay::sequence<int> new_edges; 
-				for(int j=0; j<size_of(v[i]->out_nbh); j++){
-					if(delete_set.find(v[i]->out_nbh[j]) == delete_set.end()) new_edges.push_back(v[i]->out_nbh[j]);
+	//replaces the edges from each point in affected to deleted points by
+	//edges to the deleted points' live out-neighbors, pruning if the
+	//result exceeds the degree bound; rows are rewritten in place so
+	//that concurrent searches always see valid ids
+	void repair(parlay::sequence<int> &affected, parlay::sequence<Tvec_point<T>*> &v){
+		parlay::sequence<int> new_out(maxDeg*affected.size(), -1);
+		parlay::parallel_for(0, affected.size(), [&] (size_t i){
+			tvec_point* p = v[affected[i]];
+			std::set<int> new_edges;
+			for(int j=0; j<size_of(p->out_nbh); j++){
+				int a = p->out_nbh[j];
+				if(!is_deleted(a)) new_edges.insert(a);
+				else{
+					for(int k=0; k<size_of(v[a]->out_nbh); k++){
+						int b = v[a]->out_nbh[k];
+						if(b != p->id && !is_deleted(b)) new_edges.insert(b);
+					}
 				}
-				if(new_edges.size() < size_of(v[i]->out_nbh)) add_out_nbh(new_edges, v[i]); 
 			}
+			parlay::sequence<int> candidates(new_edges.begin(), new_edges.end());
+			p->new_nbh = parlay::make_slice(new_out.begin()+maxDeg*i, new_out.begin()+maxDeg*(i+1));
+			if(candidates.size() <= maxDeg) add_new_nbh(candidates, p);
+			else robustPrune(p, candidates, v, r2_alpha, false);
 		});
+		parlay::parallel_for(0, affected.size(), [&] (size_t i) {synchronize(v[affected[i]]);});
+	}
 
-		parlay::parallel_for(0, v.size(), [&] (size_t i){
-			if(delete_set.find(i) == delete_set.end() && size_of(v[i]->out_nbh) != 0){
-				std::set<int> new_edges;
-				bool modify = false;
-				for(int j=0; j<size_of(v[i]->out_nbh); j++){
-					if(delete_set.find(v[i]->out_nbh[j]) == delete_set.end()){
-						new_edges.insert(v[i]->out_nbh[j]);
-					} else{
-						modify = true;
-						int index = v[i]->out_nbh[j];
-						for(int k=0; k<size_of(v[index]->out_nbh); k++) new_edges.insert(v[index]->out_nbh[k]);
-					}
-				}
-				//TODO only prune if overflow happens
-				//TODO modify in separate step with new memory initialized in one block
-				if(modify){ 
-					parlay::sequence<int> candidates;
-					for(int j : new_edges) candidates.push_back(j);
-					parlay::sequence<int> new_neighbors(maxDeg, -1);
-					v[i]->new_nbh = parlay::make_slice(new_neighbors.begin(), new_neighbors.end());
-					robustPrune(v[i], candidates, v, r2_alpha, false);
-					synchronize(v[i]);
-				}
-				
-			} 
+	//Repairs only the neighborhoods touched by the pending deletes: the
+	//points adjacent to a deleted point (Vamana's edges are mostly
+	//bidirectional, so these are nearly all of its in-neighbors) whose
+	//rows contain a deleted point.  Deleted points keep their rows so
+	//that any remaining edges into them still route searches; the full
+	//consolidate_deletes removes those.  Safe to run concurrently with
+	//searches.  Returns the number of repaired points.
+	size_t consolidate_incremental(parlay::sequence<Tvec_point<T>*> &v){
+		if(pending.size() == 0) return 0;
+		auto touched = parlay::flatten(parlay::map(pending, [&] (int p){
+			return parlay::to_sequence(v[p]->out_nbh.cut(0, size_of(v[p]->out_nbh)));}));
+		auto candidates = parlay::remove_duplicates(parlay::filter(touched, [&] (int a) {return !is_deleted(a);}));
+		auto affected = parlay::filter(candidates, [&] (int a){
+			for(int j=0; j<size_of(v[a]->out_nbh); j++) if(is_deleted(v[a]->out_nbh[j])) return true;
+			return false;
 		});
+		repair(affected, v);
+		pending.clear();
+		return affected.size();
+	}
+
+	//Repairs every live point with an edge to a deleted point, then
+	//clears the rows of the deleted points, after which they can be
+	//inserted again.  Not safe to run concurrently with searches.
+	void consolidate_deletes(parlay::sequence<Tvec_point<T>*> &v){
+		if(deleted.size() == 0) return;
+		auto all = parlay::tabulate(v.size(), [&] (size_t i) {return static_cast<int>(i);});
+		auto affected = parlay::filter(all, [&] (int a){
+			if(is_deleted(a)) return false;
+			for(int j=0; j<size_of(v[a]->out_nbh); j++) if(is_deleted(v[a]->out_nbh[j])) return true;
+			return false;
+		});
+		repair(affected, v);
 		parlay::parallel_for(0, v.size(), [&] (size_t i){
-			if(delete_set.find(i) != delete_set.end()){
-				clear(v[i]);
-			} 
+			if(is_deleted(i)) clear(v[i]);
 		});
- 
-		delete_set.clear();
-
+		pending.clear();
 	}
 
 	void insert_and_count(parlay::sequence<int> &inserts, parlay::sequence<Tvec_point<T>*> &v, 
@@ -321,47 +393,70 @@ struct knn_index{
 		});	
 	}
 
+	//the points sharing a label with p explored by a search for p
+	//restricted to its labels, starting from their start points (or
+	//the medoid if p has none); the other points explored on the way
+	//are not candidates, so that they do not crowd p's labels out of
+	//its neighborhood
+	parlay::sequence<pid> filtered_visited(tvec_point* p, parlay::sequence<Tvec_point<T>*> &v){
+		parlay::sequence<int> starts;
+		for(int l : p->labels)
+			if(l < (int) label_starts.size() && label_starts[l] != -1 && label_starts[l] != p->id)
+				starts.push_back(label_starts[l]);
+		if(starts.size() == 0) starts.push_back(medoid->id);
+		auto start = [&] (size_t i) {return starts[i];};
+		auto nbrs = [&] (int a) {return v[a]->out_nbh;};
+		auto dist = full_distance(p, v, d, mips);
+		auto prefetch = full_prefetch(v, d);
+		auto match = [&] (int a) {return p->labels.size() == 0 || shares_label(v[a]->labels, p->labels);};
+		beam_scratch& S = get_beam_scratch();
+		filtered_search_scratch(p->id, starts.size(), start, nbrs, dist, prefetch, match,
+		                        beamSize, mips, 0, 1.14, -1, S);
+		parlay::sequence<pid> visited;
+		for(pid a : S.visited) if(match(a.first)) visited.push_back(a);
+		return visited;
+	}
+
 	void batch_insert(parlay::sequence<int> &inserts, parlay::sequence<Tvec_point<T>*> &v, bool random_order = false, double alpha = 1.2, double base = 2,
 		double max_fraction = .02, bool two_pass = false){
 		std::cout << "alpha " << alpha << std::endl; 
 		if(two_pass == false){
 			for(int p : inserts){
-				if(p < 0 || p > (int) v.size() || (v[p]->out_nbh[0] != -1 && v[p]->id != medoid->id)){
+				if(p < 0 || p >= (int) v.size() || (v[p]->out_nbh[0] != -1 && v[p]->id != medoid->id)){
 					std::cout << "ERROR: invalid or already inserted point " << p << " given to batch_insert" << std::endl;
 					abort();
 				}
 			}
 		}
+		//a deleted point whose row has been cleared may be inserted again
+		for(int p : inserts) if(is_deleted(p)) {deleted[p].store(false); num_deleted--;}
 		size_t n = v.size();
 		size_t m = inserts.size();
-		size_t inc = 0;
+		double batch = 1;
 		size_t count = 0;
-		size_t max_batch_size=1;  
-		// size_t max_batch_size = std::min(static_cast<size_t>(max_fraction*static_cast<float>(n)), 1000000ul);
+		size_t max_batch_size = std::max(std::min(static_cast<size_t>(max_fraction*static_cast<float>(n)), 1000000ul), 1ul);
 		parlay::sequence<int> rperm;
 		if(random_order) rperm = parlay::random_permutation<int>(static_cast<int>(m));
 		else rperm = parlay::tabulate(m, [&] (int i) {return i;});
 		auto shuffled_inserts = parlay::tabulate(m, [&] (size_t i) {return inserts[rperm[i]];});
+		//batches grow geometrically up to max_batch_size, so that the
+		//first points are inserted into a graph that is not too sparse
 		while(count < m){
-			size_t floor;
-			size_t ceiling;
-			if(pow(base,inc) <= max_batch_size){
-				floor = static_cast<size_t>(pow(base, inc))-1;
-				ceiling = std::min(static_cast<size_t>(pow(base, inc+1)), m)-1;
-				count = std::min(static_cast<size_t>(pow(base, inc+1)), m)-1;
-			} else{
-				floor = count;
-				ceiling = std::min(count + static_cast<size_t>(max_batch_size), m)-1;
-				count += static_cast<size_t>(max_batch_size);
-			}
+			size_t batch_size = std::min(static_cast<size_t>(batch), max_batch_size);
+			size_t floor = count;
+			size_t ceiling = std::min(count + batch_size, m);
+			count = ceiling;
 			parlay::sequence<int> new_out = parlay::sequence<int>(maxDeg*(ceiling-floor), -1);
 			//search for each node starting from the medoid, then call
 			//robustPrune with the visited list as its candidate set
 			parlay::parallel_for(floor, ceiling, [&] (size_t i){
 				size_t index = shuffled_inserts[i];
 				v[index]->new_nbh = parlay::make_slice(new_out.begin()+maxDeg*(i-floor), new_out.begin()+maxDeg*(i+1-floor));
-				parlay::sequence<pid> visited = (beam_search(v[index], v, medoid, beamSize, d, mips)).first.second;
+				parlay::sequence<pid> visited = filtered ? filtered_visited(v[index], v) :
+					(beam_search(v[index], v, medoid, beamSize, d, mips)).first.second;
 				if(report_stats) v[index]->visited = visited.size();
+				if(num_deleted > 0)
+					visited = parlay::filter(visited, [&] (pid a) {return !is_deleted(a.first);});
 				robustPrune(v[index], visited, v, alpha);
 			});
 			//make each edge bidirectional by first adding each new edge
@@ -390,7 +485,7 @@ struct knn_index{
 					synchronize(v[index]);
 				}
 			});
-			inc += 1;
+			batch = std::min(batch*base, static_cast<double>(max_batch_size));
 		}
 	}
 
@@ -400,9 +495,11 @@ struct knn_index{
 		batch_insert(inserts, v, true);
 	}
 
+	//checks that no deleted point remains in the graph; only holds
+	//right after consolidate_deletes
 	void check_index(parlay::sequence<Tvec_point<T>*> &v){
 		parlay::parallel_for(0, v.size(), [&] (size_t i){
-      if(v[i]->id > 1000000 && v[i]->id != medoid->id){
+      if(is_deleted(i)){
       	if(size_of(v[i]->out_nbh) != 0) {
       		std::cout << "ERROR : deleted point " << i << " still in graph" << std::endl; 
       		abort();
@@ -410,7 +507,7 @@ struct knn_index{
       }else{
       	for(int j=0; j<size_of(v[i]->out_nbh); j++){
       		int nbh = v[i]->out_nbh[j];
-      		if(nbh > 1000000 && nbh != medoid->id){
+      		if(is_deleted(nbh)){
       			std::cout << "ERROR : point " << i << " contains deleted neighbor " << nbh << std::endl; 
       			abort();
       		}
@@ -420,8 +517,32 @@ struct knn_index{
 	}
 
 
-  void searchNeighbors(parlay::sequence<Tvec_point<T>*> &q, parlay::sequence<Tvec_point<T>*> &v, int beamSizeQ, int k, float cut){
-    searchAll(q, v, beamSizeQ, k, d, medoid, mips, cut);
+  //searches from the medoid and returns the k nearest points that are
+  //not deleted (padded with -1 if the beam holds fewer); safe to run
+  //concurrently with batch_insert, lazy_delete and consolidate_incremental
+  void searchNeighbors(parlay::sequence<Tvec_point<T>*> &q, parlay::sequence<Tvec_point<T>*> &v, int beamSizeQ, int k, float cut=1.14){
+    if ((k + 1) > beamSizeQ) {
+      std::cout << "Error: beam search parameter Q = " << beamSizeQ
+                << " same size or smaller than k = " << k << std::endl;
+      abort();
+    }
+    int start_id = medoid->id;
+    auto start = [&] (size_t i) {return start_id;};
+    auto nbrs = [&] (int a) {return v[a]->out_nbh;};
+    auto prefetch = full_prefetch(v, d);
+    parlay::parallel_for(0, q.size(), [&] (size_t i){
+      auto dist = full_distance(q[i], v, d, mips);
+      beam_scratch& S = get_beam_scratch();
+      size_t dist_cmps = graph_search_scratch(-1, 1, start, nbrs, dist, prefetch,
+                                              beamSizeQ, mips, k, cut, -1, S);
+      parlay::sequence<int> neighbors(k, -1);
+      int found = 0;
+      for (size_t j = 0; j < S.frontier.size() && found < k; j++)
+        if (!is_deleted(S.frontier[j].id)) neighbors[found++] = S.frontier[j].id;
+      q[i]->ngh = neighbors;
+      q[i]->visited = S.visited.size();
+      q[i]->dist_calls = dist_cmps;
+    });
   }
 
   void rangeSearch(parlay::sequence<Tvec_point<T>*> &q, parlay::sequence<Tvec_point<T>*> &v, 
@@ -33,6 +33,7 @@
 #include "../utils/stats.h"
 #include "../utils/parse_results.h"
 #include "../utils/check_nn_recall.h"
+#include "../utils/index_file.h"
 
 extern bool report_stats;
 
@@ -47,11 +48,14 @@ void ANN(parlay::sequence<Tvec_point<T>*> &v, int k, int maxDeg,
   findex I(maxDeg, beamSize, alpha, d, mips);
   double idx_time;
   if(graph_built){
-    I.find_approx_medoid(v);
+    if(index_info.start_points.size() > 0) I.set_medoid(v[index_info.start_points[0]]);
+    else I.find_approx_medoid(v);
+    I.init_tombstones(v.size());
     idx_time = 0;
   } else{
     parlay::sequence<int> inserts = parlay::tabulate(v.size(), [&] (size_t i){
 					    return static_cast<int>(i);});
+    if(base_labels.size() > 0) I.enable_filters(base_labels.num_labels);
     I.build_index(v, inserts);
     idx_time = t.next_time();
   }
@@ -59,6 +63,12 @@ void ANN(parlay::sequence<Tvec_point<T>*> &v, int k, int maxDeg,
   int medoid = I.get_medoid();
   std::string name = "Vamana";
   std::string params = "R = " + std::to_string(maxDeg) + ", L = " + std::to_string(beamSize);
+  if(I.filtered) params += ", label-aware";
+  if(!graph_built){
+    index_info.algorithm = name;
+    index_info.params = params + ", alpha = " + std::to_string(alpha);
+    index_info.start_points = {medoid};
+  }
   auto [avg_deg, max_deg] = graph_stats(v);
   auto vv = visited_stats(v);
   std::cout << "Average visited: " << vv[0] << ", Tail visited: " << vv[1] << std::endl;
@@ -76,12 +86,20 @@ void ANN(parlay::sequence<Tvec_point<T>*> v, int maxDeg, int beamSize, double al
     unsigned d = (v[0]->coordinates).size();
     using findex = knn_index<T>;
     findex I(maxDeg, beamSize, alpha, d, mips);
-    if(graph_built) I.find_approx_medoid(v);
-    else{
+    if(graph_built){
+      if(index_info.start_points.size() > 0) I.set_medoid(v[index_info.start_points[0]]);
+      else I.find_approx_medoid(v);
+      I.init_tombstones(v.size());
+    } else{
       parlay::sequence<int> inserts = parlay::tabulate(v.size(), [&] (size_t i){
 					    return static_cast<int>(i);});
+      if(base_labels.size() > 0) I.enable_filters(base_labels.num_labels);
       I.build_index(v, inserts);
       t.next("Built index");
+      index_info.algorithm = "Vamana";
+      index_info.params = "R = " + std::to_string(maxDeg) + ", L = " + std::to_string(beamSize) +
+        ", alpha = " + std::to_string(alpha) + (I.filtered ? ", label-aware" : "");
+      index_info.start_points = {I.get_medoid()};
     }
     if(report_stats){
       graph_stats(v);
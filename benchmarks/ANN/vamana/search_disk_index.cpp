@@ -0,0 +1,116 @@
+#include <iostream>
+#include <algorithm>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/io.h"
+#include "../utils/types.h"
+#include "../utils/NSGDist.h"
+#include "../utils/parse_files.h"
+#include "../utils/beamSearch.h"
+#include "../utils/stats.h"
+#include "../utils/parse_results.h"
+#include "../utils/check_nn_recall.h"
+#include "../utils/disk_search.h"
+
+bool report_stats = true;
+quant_options quant_opt;
+
+// searches an index file written by neighbors with -o and -sv 1
+// without loading it, see disk_search.h
+template<typename T>
+void search_disk_index(char* iFile, parlay::sequence<Tvec_point<T>> &qpoints,
+                       parlay::sequence<ivec_point> &groundTruth, size_t cache_nodes,
+                       bool use_pq, char* res_file){
+  parlay::internal::timer t("disk search", report_stats);
+  disk_index<T> I(iFile);
+  if(use_pq && !I.load_pq())
+    std::cout << "Index has no PQ codes (write it with -spq), searching with full vectors" << std::endl;
+  I.build_cache(cache_nodes);
+  std::cout << "In-memory footprint " << I.memory_in_bytes()/(1024*1024) << " MB, index file "
+            << I.H.file_size/(1024*1024) << " MB" << std::endl;
+  t.next("Opened index");
+
+  auto qpts = parlay::tabulate(qpoints.size(), [&] (size_t i) -> Tvec_point<T>* {
+      return &qpoints[i];});
+  auto check = [&] (int k, int Q, float cut, int limit) {
+    parlay::sequence<disk_stats> io;
+    parlay::internal::timer tq;
+    diskSearchAll(qpts, I, Q, k, cut, limit, io);
+    tq.next_time();
+    diskSearchAll(qpts, I, Q, k, cut, limit, io);
+    float query_time = tq.next_time();
+    float recall = nn_recall(qpts, groundTruth, 10);
+    float QPS = qpts.size()/query_time;
+    size_t reads = parlay::reduce(parlay::map(io, [] (disk_stats& s) {return s.reads;}));
+    size_t hits = parlay::reduce(parlay::map(io, [] (disk_stats& s) {return s.hits;}));
+    std::cout << "k = " << k << ", Q = " << Q << ", cut = " << cut << ", recall = " << recall
+              << ", QPS = " << QPS << ", reads/query = " << ((double) reads)/qpts.size()
+              << ", cache hit rate = " << ((double) hits)/std::max<size_t>(1, reads+hits) << std::endl;
+    nn_result N(recall, query_stats(qpts), QPS, k, Q, cut, qpts.size());
+    return N;
+  };
+  auto [avg_deg, max_deg] = I.degree_stats();
+  std::string params = std::string(I.H.params) + (I.use_pq ? ", disk, PQ" + std::to_string(I.PQ.m) : ", disk") +
+    ", cache = " + std::to_string(cache_nodes);
+  Graph G(I.H.algorithm, params, I.n, avg_deg, max_deg, 0);
+  G.print();
+  sweep_and_parse(G, res_file, check);
+}
+
+int main(int argc, char* argv[]) {
+  commandLine P(argc,argv,
+    "[-cache <nodes>] [-pq <usePQ>] [-res <rF>] -q <qF> -c <gF> -f <ft> -t <tp> <indexFile>");
+  char* iFile = P.getArgument(0);
+  char* qFile = P.getOptionValue("-q");
+  char* cFile = P.getOptionValue("-c");
+  char* rFile = P.getOptionValue("-res");
+  char* filetype = P.getOptionValue("-f");
+  char* vectype = P.getOptionValue("-t");
+  long cache_nodes = P.getOptionLongValue("-cache", 100000);
+  if(cache_nodes < 0) P.badArgument();
+  int pq = P.getOptionIntValue("-pq", 1);
+  if(pq < 0 | pq > 1) P.badArgument();
+  if(qFile == NULL || cFile == NULL || filetype == NULL || vectype == NULL) P.badArgument();
+
+  std::string ft = std::string(filetype);
+  std::string tp = std::string(vectype);
+
+  if((ft != "bin") && (ft != "vec")){
+    std::cout << "Error: file type not specified correctly, specify bin or vec" << std::endl;
+    abort();
+  }
+
+  if((tp != "uint8") && (tp != "int8") && (tp != "float")){
+    std::cout << "Error: vector type not specified correctly, specify int8, uint8, or float" << std::endl;
+    abort();
+  }
+
+  if((ft == "vec") && (tp == "int8")){
+    std::cout << "Error: incompatible file and vector types" << std::endl;
+    abort();
+  }
+
+  parlay::sequence<ivec_point> groundTruth;
+  if(ft == "vec"){
+    groundTruth = parse_ivecs(cFile);
+    if(tp == "float"){
+      auto [fd, qpoints] = parse_fvecs(qFile, NULL, 0);
+      search_disk_index<float>(iFile, qpoints, groundTruth, cache_nodes, pq == 1, rFile);
+    } else if(tp == "uint8"){
+      auto [fd, qpoints] = parse_bvecs(qFile, NULL, 0);
+      search_disk_index<uint8_t>(iFile, qpoints, groundTruth, cache_nodes, pq == 1, rFile);
+    }
+  } else if(ft == "bin"){
+    groundTruth = parse_ibin(cFile);
+    if(tp == "float"){
+      auto [fd, qpoints] = parse_fbin(qFile, NULL, 0);
+      search_disk_index<float>(iFile, qpoints, groundTruth, cache_nodes, pq == 1, rFile);
+    } else if(tp == "uint8"){
+      auto [fd, qpoints] = parse_uint8bin(qFile, NULL, 0);
+      search_disk_index<uint8_t>(iFile, qpoints, groundTruth, cache_nodes, pq == 1, rFile);
+    } else if(tp == "int8"){
+      auto [fd, qpoints] = parse_int8bin(qFile, NULL, 0);
+      search_disk_index<int8_t>(iFile, qpoints, groundTruth, cache_nodes, pq == 1, rFile);
+    }
+  }
+}
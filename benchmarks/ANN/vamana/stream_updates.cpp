@@ -0,0 +1,290 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/io.h"
+#include "../utils/types.h"
+#include "../utils/NSGDist.h"
+#include "../utils/parse_files.h"
+#include "../utils/beamSearch.h"
+#include "../utils/csvfile.h"
+#include "index.h"
+
+bool report_stats = false;
+
+// *************************************************************
+//  Replays a trace of inserts, deletes and queries against a
+//  Vamana index.  The updates between two query steps run
+//  concurrently with repeated passes of the query set; deletes are
+//  followed by consolidate_incremental in the same branch.  After
+//  each step the queries are run again on the quiescent index and
+//  their recall is measured against the points live at that time.
+//
+//  Trace files have one operation per line:
+//    build <first> <count>    build the index on [first, first+count)
+//    insert <first> <count>   insert [first, first+count)
+//    delete <first> <count>   delete [first, first+count)
+//    query                    end the current step
+//  Without a trace, a sliding window is replayed: the index is built
+//  on the first -init points, and each step inserts the next -batch
+//  points and deletes the oldest -batch.
+// *************************************************************
+
+struct trace_op {
+  std::string type;
+  int first;
+  int count;
+};
+
+parlay::sequence<trace_op> read_trace(const char* file){
+  std::ifstream in(file);
+  if(!in.is_open()){
+    std::cout << "Error: could not open trace " << file << std::endl;
+    abort();
+  }
+  parlay::sequence<trace_op> ops;
+  std::string line;
+  while(std::getline(in, line)){
+    std::istringstream ls(line);
+    trace_op op{"", 0, 0};
+    if(!(ls >> op.type) || op.type[0] == '#') continue;
+    if(op.type != "query" && !(ls >> op.first >> op.count)){
+      std::cout << "Error: bad trace line: " << line << std::endl;
+      abort();
+    }
+    if(op.type != "build" && op.type != "insert" && op.type != "delete" && op.type != "query"){
+      std::cout << "Error: unknown trace operation " << op.type << std::endl;
+      abort();
+    }
+    ops.push_back(op);
+  }
+  if(ops.size() == 0 || ops[0].type != "build"){
+    std::cout << "Error: a trace must start with a build" << std::endl;
+    abort();
+  }
+  return ops;
+}
+
+parlay::sequence<trace_op> sliding_window(size_t n, size_t init, size_t batch, size_t rounds){
+  parlay::sequence<trace_op> ops = {trace_op{"build", 0, (int) init}, trace_op{"query", 0, 0}};
+  for(size_t r=0; r<rounds && init + (r+1)*batch <= n; r++){
+    ops.push_back(trace_op{"insert", (int) (init + r*batch), (int) batch});
+    ops.push_back(trace_op{"delete", (int) (r*batch), (int) batch});
+    ops.push_back(trace_op{"query", 0, 0});
+  }
+  return ops;
+}
+
+// exact k nearest live neighbors of each query, by brute force
+template<typename T>
+parlay::sequence<parlay::sequence<int>> live_groundtruth(parlay::sequence<Tvec_point<T>*> &v,
+    parlay::sequence<Tvec_point<T>*> &q, parlay::sequence<bool> &live, int k, bool mips){
+  unsigned d = v[0]->coordinates.size();
+  auto ids = parlay::filter(parlay::iota<int>(v.size()), [&] (int i) {return live[i];});
+  return parlay::tabulate(q.size(), [&] (size_t i){
+    auto dists = parlay::map(ids, [&] (int j){
+      T* a = v[j]->coordinates.begin();
+      T* b = q[i]->coordinates.begin();
+      return std::make_pair(mips ? mips_distance(a, b, d) : distance(a, b, d), j);
+    }, 1000);
+    size_t kk = std::min<size_t>(k, dists.size());
+    std::nth_element(dists.begin(), dists.begin() + kk, dists.end());
+    return parlay::tabulate(kk, [&] (size_t j) {return dists[j].second;});
+  });
+}
+
+template<typename T>
+double live_recall(parlay::sequence<Tvec_point<T>*> &q, parlay::sequence<parlay::sequence<int>> &gt, int r){
+  size_t correct = 0, total = 0;
+  for(size_t i=0; i<q.size(); i++){
+    size_t rr = std::min<size_t>(r, gt[i].size());
+    for(size_t j=0; j<rr; j++){
+      total++;
+      for(size_t l=0; l<rr; l++) if(q[i]->ngh[l] == gt[i][j]) {correct++; break;}
+    }
+  }
+  return total == 0 ? 1.0 : ((double) correct)/total;
+}
+
+template<typename T>
+void stream(parlay::sequence<Tvec_point<T>> &pts, parlay::sequence<Tvec_point<T>> &qpts_in,
+            parlay::sequence<trace_op> &ops, int R, int L, double alpha, int k, int Q,
+            int full, bool mips, char* res_file){
+  size_t n = pts.size();
+  unsigned d = pts[0].coordinates.size();
+  auto v = parlay::tabulate(n, [&] (size_t i) -> Tvec_point<T>* {return &pts[i];});
+  auto q = parlay::tabulate(qpts_in.size(), [&] (size_t i) -> Tvec_point<T>* {return &qpts_in[i];});
+  parlay::sequence<bool> live(n, false);
+  knn_index<T> I(R, L, alpha, d, mips);
+
+  auto range = [&] (trace_op& op){
+    if(op.first < 0 || op.count < 0 || (size_t) op.first + op.count > n){
+      std::cout << "Error: trace range [" << op.first << ", " << op.first + op.count
+                << ") is outside the data" << std::endl;
+      abort();
+    }
+    return parlay::tabulate(op.count, [&] (size_t i) {return (int) (op.first + i);});
+  };
+
+  parlay::internal::timer t;
+  auto initial = range(ops[0]);
+  I.build_index(v, initial);
+  for(int i : initial) live[i] = true;
+  double build_time = t.next_time();
+  std::cout << "Built index on " << initial.size() << " points in " << build_time << " seconds" << std::endl;
+
+  std::unique_ptr<csvfile> csv;
+  if(res_file != NULL){
+    csv = std::make_unique<csvfile>(std::string(res_file));
+    *csv << "Step" << "Live points" << "Inserts" << "Insert throughput" << "Deletes"
+         << "Delete throughput" << "Repaired" << "Concurrent QPS" << "QPS" << "Recall" << endrow;
+  }
+  std::cout << "step\tlive\tinserts\tins/s\tdeletes\tdel/s\trepaired\tconc QPS\tQPS\trecall@10" << std::endl;
+
+  size_t pos = 1;
+  int step = 0;
+  while(pos < ops.size()){
+    // the updates of this step
+    size_t end = pos;
+    while(end < ops.size() && ops[end].type != "query") end++;
+    size_t inserted = 0, deleted = 0, repaired = 0;
+    double insert_time = 0, delete_time = 0;
+    std::atomic<bool> done = false;
+    size_t concurrent_queries = 0;
+    double concurrent_time = 0;
+    parlay::par_do(
+      [&] () {
+        parlay::internal::timer tu;
+        for(size_t j=pos; j<end; j++){
+          auto ids = range(ops[j]);
+          if(ops[j].type == "insert"){
+            I.batch_insert(ids, v, true);
+            for(int i : ids) live[i] = true;
+            inserted += ids.size();
+            insert_time += tu.next_time();
+          } else if(ops[j].type == "delete"){
+            I.lazy_delete(ids, v);
+            repaired += I.consolidate_incremental(v);
+            for(int i : ids) if(I.is_deleted(i)) {live[i] = false; deleted++;}
+            delete_time += tu.next_time();
+          } else {
+            std::cout << "Error: build may only start a trace" << std::endl;
+            abort();
+          }
+        }
+        done = true;
+      },
+      [&] () {
+        parlay::internal::timer tq;
+        do {
+          I.searchNeighbors(q, v, Q, k);
+          concurrent_queries += q.size();
+        } while(!done);
+        concurrent_time = tq.next_time();
+      });
+    if(full > 0 && step > 0 && step % full == 0) I.consolidate_deletes(v);
+
+    // the quiescent pass
+    parlay::internal::timer tq;
+    I.searchNeighbors(q, v, Q, k);
+    double qps = q.size()/tq.next_time();
+    auto gt = live_groundtruth(v, q, live, 10, mips);
+    double recall = live_recall(q, gt, std::min(k, 10));
+    size_t num_live = parlay::count(live, true);
+    double ins_tp = insert_time > 0 ? inserted/insert_time : 0;
+    double del_tp = delete_time > 0 ? deleted/delete_time : 0;
+    double conc_qps = end > pos ? concurrent_queries/concurrent_time : 0;
+    std::cout << step << "\t" << num_live << "\t" << inserted << "\t" << ins_tp << "\t"
+              << deleted << "\t" << del_tp << "\t" << repaired << "\t" << conc_qps << "\t"
+              << qps << "\t" << recall << std::endl;
+    if(csv) *csv << step << num_live << inserted << ins_tp << deleted << del_tp << repaired
+                 << conc_qps << qps << recall << endrow;
+    step++;
+    pos = end + 1;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  commandLine P(argc,argv,
+    "[-a <alpha>] [-R <deg>] [-L <bm>] [-k <k>] [-Q <bmq>] [-D <df>] [-trace <tF>] "
+    "[-init <points>] [-batch <points>] [-rounds <r>] [-full <steps>] [-res <rF>] "
+    "-q <qF> -f <ft> -t <tp> <inFile>");
+  char* iFile = P.getArgument(0);
+  char* qFile = P.getOptionValue("-q");
+  char* tFile = P.getOptionValue("-trace");
+  char* rFile = P.getOptionValue("-res");
+  char* filetype = P.getOptionValue("-f");
+  char* vectype = P.getOptionValue("-t");
+  int R = P.getOptionIntValue("-R", 32);
+  if (R < 1) P.badArgument();
+  int L = P.getOptionIntValue("-L", 64);
+  if (L < 1) P.badArgument();
+  int k = P.getOptionIntValue("-k", 10);
+  if (k > 1000 || k < 1) P.badArgument();
+  int Q = P.getOptionIntValue("-Q", std::max(L, k+1));
+  double alpha = P.getOptionDoubleValue("-a", 1.2);
+  int dfc = P.getOptionIntValue("-D", 0);
+  if(dfc < 0 | dfc > 1) P.badArgument();
+  long init = P.getOptionLongValue("-init", 0);
+  long batch = P.getOptionLongValue("-batch", 0);
+  long rounds = P.getOptionLongValue("-rounds", 1000000);
+  int full = P.getOptionIntValue("-full", 0);
+  if(qFile == NULL || filetype == NULL || vectype == NULL) P.badArgument();
+
+  std::string ft = std::string(filetype);
+  std::string tp = std::string(vectype);
+  if((ft != "bin") && (ft != "vec")){
+    std::cout << "Error: file type not specified correctly, specify bin or vec" << std::endl;
+    abort();
+  }
+  if((tp != "uint8") && (tp != "int8") && (tp != "float")){
+    std::cout << "Error: vector type not specified correctly, specify int8, uint8, or float" << std::endl;
+    abort();
+  }
+  if((ft == "vec") && (tp == "int8")){
+    std::cout << "Error: incompatible file and vector types" << std::endl;
+    abort();
+  }
+
+  auto run = [&] (auto& points, auto& qpoints) {
+    size_t n = points.size();
+    parlay::sequence<trace_op> ops;
+    if(tFile != NULL) ops = read_trace(tFile);
+    else{
+      size_t i0 = init > 0 ? init : n/2;
+      size_t b = batch > 0 ? batch : std::max<size_t>(n/100, 1);
+      ops = sliding_window(n, std::min(i0, n), b, rounds);
+    }
+    stream(points, qpoints, ops, R, L, alpha, k, Q, full, dfc == 1, rFile);
+  };
+
+  if(ft == "vec"){
+    if(tp == "float"){
+      auto [md, points] = parse_fvecs(iFile, NULL, R);
+      auto [fd, qpoints] = parse_fvecs(qFile, NULL, 0);
+      run(points, qpoints);
+    } else if(tp == "uint8"){
+      auto [md, points] = parse_bvecs(iFile, NULL, R);
+      auto [fd, qpoints] = parse_bvecs(qFile, NULL, 0);
+      run(points, qpoints);
+    }
+  } else if(ft == "bin"){
+    if(tp == "float"){
+      auto [md, points] = parse_fbin(iFile, NULL, R);
+      auto [fd, qpoints] = parse_fbin(qFile, NULL, 0);
+      run(points, qpoints);
+    } else if(tp == "uint8"){
+      auto [md, points] = parse_uint8bin(iFile, NULL, R);
+      auto [fd, qpoints] = parse_uint8bin(qFile, NULL, 0);
+      run(points, qpoints);
+    } else if(tp == "int8"){
+      auto [md, points] = parse_int8bin(iFile, NULL, R);
+      auto [fd, qpoints] = parse_int8bin(qFile, NULL, 0);
+      run(points, qpoints);
+    }
+  }
+}
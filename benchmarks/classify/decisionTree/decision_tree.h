@@ -0,0 +1,344 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Code roughly based on C4.5 decision trees
+// Works with discrete or continuous features.
+// Tries all binary cuts for continuous variables, and picks best.
+// The target label must be discrete (i.e. no regression).
+// Adds cost of encoding a node to each node for the purpose of pruning.
+
+// The tree is built a level at a time.  Each node holds the indices of
+// its rows, and large nodes also hold for each feature a histogram of
+// (label, value) pairs over those rows, which is all that is needed to
+// pick the split.  The histograms of the largest child of a large node
+// are the parent's minus those of its other children, so most rows
+// are not looked at again.  A node is large if it has at least as
+// many rows per feature as there are histogram entries per feature,
+// so the histograms of a level take no more space than the features.
+// Small nodes compute the histograms they need from their rows when
+// they are split, and drop them right after.
+
+// For random forests a tree can be built on any multiset of the rows
+// (e.g. a bootstrap sample), and each node can choose its split from
+// a random subset of the features.
+// Requires classify.h to be included first.
+
+#include <iostream>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+#include "parlay/delayed.h"
+#include "parlay/io.h"
+#include "parlay/internal/get_time.h"
+
+using namespace parlay;
+using std::cout;
+using std::endl;
+double infinity = std::numeric_limits<double>::infinity();
+
+// some parameters
+
+// minimum size of a node
+size_t min_size = 1;
+// the following helps prevent overfitting if > 0.0
+// probably should be in range [0..1]
+double encode_node_factor = 0.0; 
+
+// below this many rows histograms are computed sequentially
+size_t seq_hist_size = 2000;
+
+struct tree {
+  bool is_leaf;
+  int feature_index;
+  int feature_cut;
+  int best;
+  size_t size;
+  sequence<tree*> children;
+  // children are filled in later
+  tree(int i, int c, int best, int m)
+    : is_leaf(false), best(best), feature_index(i), feature_cut(c), size(0),
+      children(m, nullptr) {}
+  tree(int best) : is_leaf(true), best(best), size(1) {}
+};
+
+tree* Leaf(int best) {
+  if (best > max_value) abort();
+  return new tree(best);
+}
+
+tree* Internal(int i, int cut, int majority, int m) {
+  return new tree(i, cut, majority, m);
+}
+
+// sets the size (number of leaves) of each internal node
+size_t set_sizes(tree* T) {
+  if (T->is_leaf) return T->size;
+  T->size = reduce(map(T->children, [] (tree* c) {return set_sizes(c);}, 1));
+  return T->size;
+}
+
+// entropy * total given a histogram a (total = sum(a))
+template <typename Seq>
+double entropy(Seq a, int total) {
+  double ecost = encode_node_factor * log2(float(1 + total)); // to prevent overfitting
+  return ecost + reduce(delayed_map(a, [=] (int l) {
+      return (l > 0) ? -(l * log2(float(l)/total)) : 0.0;}));
+}
+
+// sums[i + j * a_num] is the number of rows with label i and value j
+// for the feature, and n the number of rows
+auto cond_info_continuous(sequence<int> const &sums, int a_num, int b_num, size_t n) {
+  sequence<int> low_counts(a_num, 0);
+  sequence<int> high_counts(a_num, 0);
+  for (int i=0; i < b_num; i++) 
+    for (int j=0; j < a_num; j++) high_counts[j] += sums[a_num*i + j];
+  double cur_e = infinity;
+  int cur_i = 0;
+  int m = 0;
+  for (int i=0; i < b_num-1; i++) {
+    for (int j=0; j < a_num; j++) {
+      low_counts[j] += sums[a_num*i + j];
+      high_counts[j] -= sums[a_num*i + j];
+      m += sums[a_num*i + j];
+    }
+    double e = entropy(low_counts, m) + entropy(high_counts, n - m);
+    if (e < cur_e) {
+      cur_e = e;
+      cur_i = i+1;
+    }
+  }
+  return std::pair(cur_e, cur_i);
+}
+
+// info of the label conditioned on the feature
+double cond_info_discrete(sequence<int> const &sums, int a_num, int b_num) {
+  return reduce(tabulate(b_num, [&] (size_t i) {
+      auto x = sums.cut(i*a_num,(i+1)*a_num);				      
+      return entropy(x, reduce(x));}));
+}
+
+// information needed to describe the node
+double node_cost(int n, int num_features, int num_groups) {
+  return log2(float(num_features));
+}
+
+using histograms = sequence<sequence<int>>;
+
+// the bucket of row r in the histogram of feature f: the label for
+// feature 0, and label + value * num_labels for the others
+size_t hist_index(features const &A, size_t f, uint r) {
+  int num_labels = A[0].num;
+  return (f == 0) ? A[0].vals[r] : A[0].vals[r] + A[f].vals[r] * num_labels;
+}
+
+size_t hist_size(features const &A, size_t f) {
+  return (f == 0) ? A[0].num : A[0].num * A[f].num;
+}
+
+// the histogram of feature f over the rows
+sequence<int> feature_histogram(features const &A, sequence<uint> const &rows, size_t f) {
+  auto idx = [&] (uint r) {return hist_index(A, f, r);};
+  if (rows.size() < seq_hist_size) {
+    sequence<int> h(hist_size(A, f), 0);
+    for (uint r : rows) h[idx(r)]++;
+    return h;
+  }
+  auto h = histogram_by_index(delayed_map(rows, idx), hist_size(A, f));
+  return map(h, [] (auto c) {return (int) c;});
+}
+
+histograms node_histograms(features const &A, sequence<uint> const &rows) {
+  return tabulate(A.size(), [&] (size_t f) {
+      return feature_histogram(A, rows, f);}, 1);
+}
+
+// nodes with fewer rows than this do not keep histograms
+size_t min_hist_rows(features const &A) {
+  size_t total = reduce(tabulate(A.size(), [&] (size_t f) {return hist_size(A, f);}));
+  return total / A.size();
+}
+
+// a node still to be built
+struct node {
+  sequence<uint> rows;  // indices of its training rows, in order
+  histograms hists;     // as returned by node_histograms, or empty if small
+  tree** place;         // where to put it
+  size_t seed;          // for choosing its features
+};
+
+// tries of the features [1, num_features) chosen at random, in order,
+// or all of them if tries is 0 or at least their number
+sequence<int> choose_features(int num_features, int tries, size_t seed) {
+  auto all = tabulate(num_features - 1, [] (int i) {return i + 1;});
+  if (tries <= 0 || tries >= num_features - 1) return all;
+  for (int i = 0; i < tries; i++) {
+    int j = i + hash64(seed + i) % (num_features - 1 - i);
+    std::swap(all[i], all[j]);
+  }
+  auto chosen = to_sequence(all.cut(0, tries));
+  sort_inplace(chosen);
+  return chosen;
+}
+
+// Picks the split for N and puts a leaf or an internal node at its
+// place.  Returns the children still to be built.
+sequence<node> build_node(features const &A, node &N, int tries, size_t hist_rows,
+			  bool verbose) {
+  int num_features = A.size();
+  int num_entries = N.rows.size();
+  bool small = N.hists.size() == 0;
+  sequence<int> small_labels;
+  if (small) small_labels = feature_histogram(A, N.rows, 0);
+  sequence<int> const &label_counts = small ? small_labels : N.hists[0];
+  int majority_value = (num_entries == 0) ? -1 :
+    max_element(label_counts) - label_counts.begin();
+  bool all_equal = count_if(label_counts, [] (int c) {return c > 0;}) <= 1;
+  if (num_entries < 2 || all_equal) {
+    *N.place = Leaf(majority_value);
+    return sequence<node>();
+  }
+  double label_info = entropy(label_counts, num_entries);
+  int num_labels = A[0].num;
+  auto min1 = [&] (auto a, auto b) {return (std::get<0>(a) < std::get<0>(b)) ? a : b;};
+  auto min_m = make_monoid(min1, std::tuple(infinity, 0, 0));
+  auto best_split = [&] (sequence<int> const &candidates) {
+    auto costs = tabulate(candidates.size(), [&] (size_t k) {
+	int i = candidates[k];
+	sequence<int> small_hist;
+	if (small) small_hist = feature_histogram(A, N.rows, i);
+	sequence<int> const &hist = small ? small_hist : N.hists[i];
+	if (A[i].discrete) {
+	  return std::tuple(cond_info_discrete(hist, num_labels, A[i].num), i, -1);
+	} else {
+	  auto info_cut = cond_info_continuous(hist, num_labels, A[i].num,
+					       num_entries);
+	  return std::tuple(info_cut.first, i, info_cut.second);
+	}},1);
+    return reduce(costs, min_m);};
+  double threshold = log2(float(num_features));
+
+  auto best = best_split(choose_features(num_features, tries, N.seed));
+  // if none of the chosen features is worth splitting on, try them all
+  if (label_info - std::get<0>(best) < threshold && tries > 0 && tries < num_features - 1)
+    best = best_split(choose_features(num_features, 0, 0));
+  auto [best_info, best_i, cutx] = best;
+  auto cut = cutx;
+
+  if (verbose)
+    cout << num_entries << ", " << best_i << ", " << cut << ", " << label_info << ", " 
+	 << best_info << endl;
+
+  if (label_info - best_info < threshold) {
+    *N.place = Leaf(majority_value);
+    return sequence<node>();
+  }
+
+  bool discrete = A[best_i].discrete;
+  int m = discrete ? A[best_i].num : 2;
+  row const &split_vals = A[best_i].vals;
+  tree* T = Internal(best_i - 1, cut, majority_value, m); //-1 since first is label
+  *N.place = T;
+
+  // split the rows, keeping them in order
+  auto groups = group_by_index(delayed_map(N.rows, [&] (uint r) {
+	value v = split_vals[r];
+	return std::pair<int,uint>(discrete ? v : (v >= cut), r);}), m);
+  N.rows.clear();
+  auto sizes = map(groups, [] (auto const &g) {return g.size();});
+  size_t largest = max_element(sizes) - sizes.begin();
+
+  sequence<node> children = tabulate(m, [&] (size_t i) {
+      node c;
+      c.rows = std::move(groups[i]);
+      if (i != largest && c.rows.size() >= hist_rows)
+	c.hists = node_histograms(A, c.rows);
+      c.place = &T->children[i];
+      c.seed = hash64(N.seed + i + 1);
+      return c;}, 1);
+
+  // the histograms of the largest child are those of the parent minus
+  // those of the others, subtracting small ones a row at a time
+  if (!small && children[largest].rows.size() >= hist_rows) {
+    histograms &H = children[largest].hists;
+    H = std::move(N.hists);
+    parallel_for(0, num_features, [&] (size_t f) {
+	for (size_t i = 0; i < m; i++) {
+	  if (i == largest) continue;
+	  node const &c = children[i];
+	  if (c.hists.size() > 0)
+	    for (size_t j = 0; j < H[f].size(); j++) H[f][j] -= c.hists[f][j];
+	  else for (uint r : c.rows) H[f][hist_index(A, f, r)]--;
+	}
+      }, 1);
+  }
+  return children;
+}
+
+// builds a tree on the given rows (in order, possibly repeated),
+// choosing each split from tries random features (0 for all)
+tree* build_tree(features const &A, sequence<uint> rows, int tries, size_t seed,
+		 bool verbose) {
+  tree* root;
+  size_t hist_rows = min_hist_rows(A);
+  sequence<node> level(1);
+  if (rows.size() >= hist_rows) level[0].hists = node_histograms(A, rows);
+  level[0].rows = std::move(rows);
+  level[0].place = &root;
+  level[0].seed = seed;
+  while (level.size() > 0) {
+    auto next = tabulate(level.size(), [&] (size_t i) {
+	auto children = build_node(A, level[i], tries, hist_rows, verbose);
+	level[i] = node();  // free its rows and histograms
+	return children;}, 1);
+    auto offsets = map(next, [] (auto const &c) {return c.size();});
+    size_t total = scan_inplace(offsets);
+    sequence<node> new_level(total);
+    parallel_for(0, next.size(), [&] (size_t i) {
+	for (size_t j = 0; j < next[i].size(); j++)
+	  new_level[offsets[i] + j] = std::move(next[i][j]);});
+    level = std::move(new_level);
+  }
+  set_sizes(root);
+  return root;
+}
+
+tree* build_tree(features const &A, bool verbose) {
+  size_t n = A[0].vals.size();
+  return build_tree(A, tabulate(n, [] (size_t i) {return (uint) i;}), 0, 0, verbose);
+}
+
+int classify_row(tree* T, row const&r) {
+  if (T->is_leaf) {
+    return T->best;
+  } else if (T->feature_cut == -1) { // discrete partition
+    // could be a feature value in the test data that did not appear in training data
+    // in this case return the best
+    if (!(r[T->feature_index] < T->children.size())) return T->best; // -1;
+    // go to child based on feature value
+    int val = classify_row(T->children[r[T->feature_index]], r);
+    return (val == -1) ? T->best : val;
+  } else {  // continuous cut
+    // go to child based on whether below or at-above cut value
+    int idx = (r[T->feature_index] < T->feature_cut) ? 0 : 1;
+    int val = classify_row(T->children[idx], r);
+    return (val == -1) ? T->best : val;
+  }
+}
@@ -0,0 +1 @@
+../bench/classify.h
\ No newline at end of file
@@ -0,0 +1 @@
+../decisionTree/decision_tree.h
\ No newline at end of file
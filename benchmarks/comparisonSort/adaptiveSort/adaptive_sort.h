@@ -0,0 +1,112 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+
+// A sort that adapts to sorted runs in the input.
+// The places where the input descends (A[i] < A[i-1]) are found in
+// parallel, and then, in order:
+//   - if there are none it is done, and if it descends everywhere it
+//     is reversed
+//   - if there are few, the out of place elements are taken out (one
+//     per descent), sorted and merged back into the rest.  This takes
+//     O(n) work when the rest is sorted (e.g. after a few swaps)
+//   - if the runs between descents are long on average, they are
+//     merged in a tree that splits the elements in half at each
+//     level, as powersort does, for O(n (1 + H)) work where H is the
+//     entropy of the run lengths.  Each merge is parallel.
+//   - otherwise it uses sample sort
+// Not stable.
+
+// try taking out elements if there are at most n / this many descents
+constexpr size_t outlier_ratio = 64;
+
+// merge runs if they average at least this long
+constexpr size_t min_average_run = 32;
+
+// Takes out one of the two elements at each descent, whichever leaves
+// its neighbors in order.  If the rest is then sorted, sorts the ones
+// taken out, merges them back in and returns true.  Otherwise leaves
+// A unchanged and returns false.
+template <class T, class Less>
+bool merge_outliers(parlay::sequence<T> &A, parlay::sequence<size_t> const &descents,
+		    const Less& less) {
+  size_t n = A.size();
+  auto keep = parlay::sequence<bool>(n, true);
+  parlay::parallel_for(0, descents.size(), [&] (size_t j) {
+    size_t i = descents[j];
+    if (i < 2 || !less(A[i], A[i-2])) keep[i-1] = false;
+    else keep[i] = false;
+  });
+  auto K = parlay::pack(A, keep);
+  bool sorted = !parlay::any_of(parlay::iota(K.size()), [&] (size_t i) {
+      return i > 0 && less(K[i], K[i-1]);});
+  if (!sorted) return false;
+  auto X = parlay::pack(A, parlay::map(keep, [] (bool b) {return !b;}));
+  parlay::sort_inplace(X, less);
+  A = parlay::merge(K, X, less);
+  return true;
+}
+
+// merges the runs [starts[l], starts[r]) of A, splitting at the run
+// boundary nearest to the middle element
+template <class T, class Less>
+parlay::sequence<T> merge_runs(parlay::sequence<T> const &A,
+			       parlay::sequence<size_t> const &starts,
+			       size_t l, size_t r, const Less& less) {
+  if (r - l == 1)
+    return parlay::to_sequence(A.cut(starts[l], starts[r]));
+  size_t middle = (starts[l] + starts[r]) / 2;
+  size_t m = std::upper_bound(starts.begin() + l + 1, starts.begin() + r, middle)
+    - starts.begin();
+  if (m == r) m--;
+  else if (m > l + 1 && middle - starts[m-1] < starts[m] - middle) m--;
+  parlay::sequence<T> left, right;
+  parlay::par_do_if(starts[r] - starts[l] > 1000,
+		    [&] () {left = merge_runs(A, starts, l, m, less);},
+		    [&] () {right = merge_runs(A, starts, m, r, less);});
+  return parlay::merge(left, right, less);
+}
+
+template <class T, class Less>
+void adaptive_sort_inplace(parlay::sequence<T> &A, const Less& less) {
+  size_t n = A.size();
+  if (n < 2) return;
+  auto descents = parlay::pack_index(parlay::delayed_tabulate(n, [&] (size_t i) {
+	return i > 0 && less(A[i], A[i-1]);}));
+  size_t d = descents.size();
+  if (d == 0) return;
+  if (d == n - 1) {
+    A = parlay::reverse(A);
+    return;
+  }
+  if (d <= n / outlier_ratio && merge_outliers(A, descents, less)) return;
+  if (n / (d + 1) < min_average_run) {
+    parlay::sort_inplace(A, less);
+    return;
+  }
+  auto starts = parlay::tabulate(d + 2, [&] (size_t i) -> size_t {
+      return (i == 0) ? 0 : (i == d + 1) ? n : descents[i-1];});
+  A = merge_runs(A, starts, 0, d + 1, less);
+}
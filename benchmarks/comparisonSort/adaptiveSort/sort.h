@@ -0,0 +1,8 @@
+#include "adaptive_sort.h"
+
+constexpr bool INPLACE = true;
+
+template <class T, class BinPred>
+void compSort(parlay::sequence<T> &A, const BinPred& f) {
+  adaptive_sort_inplace(A, f);
+}
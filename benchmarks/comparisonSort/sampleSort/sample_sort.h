@@ -10,6 +10,7 @@
 #include <parlay/utilities.h>
 #include <parlay/internal/uninitialized_sequence.h>
 
+#include "common/perf_counters.h"
 #include "heap_tree.h"
 
 // **************************************************************
@@ -30,7 +31,7 @@
 template <typename assignment_tag, typename Range, typename Less>
 void sample_sort_(Range in, Range out, Less less, bool stable=false, int level=1) {
   long n = in.size();
-  parlay::internal::timer t("sample", level==1);
+  pbbs::perf::timer t("sample", level==1);
   using T = typename Range::value_type;
   using bucket_key_t = unsigned short;
   
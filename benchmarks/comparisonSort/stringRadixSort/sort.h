@@ -0,0 +1,19 @@
+#include <type_traits>
+#include "parlay/primitives.h"
+#include "common/string_sort.h"
+
+constexpr bool INPLACE = true;
+
+// Strings are copied into an arena and sorted with an MSD radix sort,
+// assuming f is the lexicographic order used by sortTime.  Other types
+// use parlay's sample sort.
+template <class T, class BinPred>
+void compSort(parlay::sequence<T> &A, const BinPred& f) {
+  if constexpr (std::is_same_v<T, parlay::chars>) {
+    string_sort::arena S(A);
+    auto R = string_sort::radix_sort(S);
+    auto B = parlay::tabulate(R.size(), [&] (size_t i) {
+	return std::move(A[R[i].id]);});
+    A = std::move(B);
+  } else parlay::sort_inplace(A, f);
+}
@@ -0,0 +1,20 @@
+#include <type_traits>
+#include "parlay/primitives.h"
+#include "common/string_sort.h"
+
+constexpr bool INPLACE = true;
+
+// Strings are copied into an arena and sorted with a string sample
+// sort, assuming f is the lexicographic order used by sortTime.  The
+// lcp array it also returns is not used here.  Other types use
+// parlay's sample sort.
+template <class T, class BinPred>
+void compSort(parlay::sequence<T> &A, const BinPred& f) {
+  if constexpr (std::is_same_v<T, parlay::chars>) {
+    string_sort::arena S(A);
+    auto R = string_sort::sample_sort(S).first;
+    auto B = parlay::tabulate(R.size(), [&] (size_t i) {
+	return std::move(A[R[i].id]);});
+    A = std::move(B);
+  } else parlay::sort_inplace(A, f);
+}
@@ -4,6 +4,7 @@
 
 #include "parlay/alloc.h"
 #include "parlay/primitives.h"
+#include "stats.h"
 
 #ifndef PARLAY_EPOCH_H_
 #define PARLAY_EPOCH_H_
@@ -131,12 +132,21 @@ struct alignas(64) epoch_s {
     for (int i=0; i < workers; i++)
       if ((announcements[i].last != -1l) && announcements[i].last < current_e) {
         all_there = false;
+#ifdef FlockStats
+        long oldest = current_e;
+        for (int j=i; j < workers; j++) {
+          long e = announcements[j].last;
+          if (e != -1l) oldest = std::min(oldest, e);
+        }
+        flck::stats::record(flck::stats::epoch_lag, current_e - oldest);
+#endif
         break;
       }
     // if so then increment current epoch
     if (all_there) {
       for (auto h : before_epoch_hooks) h();
       if (current_epoch.compare_exchange_strong(current_e, current_e+1)) {
+        flck::stats::count(flck::stats::epoch_advanced);
         for (auto h : after_epoch_hooks) h();
       }
     }
@@ -212,12 +222,14 @@ private:
     lnk->value = p;
     lnk->skip = false;
     pid.current = lnk;
+    flck::stats::count(flck::stats::retired);
     return &(lnk->skip);
   }
 
   // destructs and frees a linked list of objects 
   void clear_list(Link* ptr) {
     // abort();
+    long freed = 0;
     while (ptr != nullptr) {
       Link* tmp = ptr;
       ptr = ptr->next;
@@ -232,9 +244,12 @@ private:
         }
 #endif
         Delete((T*) tmp->value);
+        freed++;
       }
       free_link(tmp);
     }
+    flck::stats::count(flck::stats::reclaimed, freed);
+    flck::stats::record(flck::stats::reclaim_batch, freed);
   }
 
   // computes size of list
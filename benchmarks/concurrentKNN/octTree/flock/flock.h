@@ -116,7 +116,10 @@ std::vector<internal::lock> lock::locks{1ul << bucket_bits};
       }
       auto r = f();
       //if (try_time_taken != -1) delay = try_time_taken;
-      if (r.has_value()) return *r;
+      if (r.has_value()) {
+        stats::record(stats::lock_retries, cnt - 1);
+        return *r;
+      }
       multiplier = std::min(2*multiplier, max_multiplier);
       for (volatile int i=0; i < delay * multiplier; i++);
     }
@@ -125,6 +125,7 @@ private:
     descriptor* desc = remove_tag(le);
     bool still_locked = (read() == le);
     if (!still_locked) return false;
+    stats::count(stats::help_attempted);
     long my_epoch = epoch::internal::get_epoch().get_my_epoch();
     long other_epoch = desc->epoch_num;
     if (other_epoch < my_epoch)
@@ -139,6 +140,7 @@ private:
       (*desc)();      // run thunk to be helped
       clear(desc);    // unset the lock
       helping = hold_h; // reset helping mode
+      stats::count(stats::help_succeeded);
     }
     set_current_id(my_id); // reset thread id
     epoch::internal::get_epoch().set_my_epoch(my_epoch); // reset to my epoch
@@ -189,6 +191,7 @@ public:
     }
     
     
+    int retries = 0;
     while (true) {
       size_t old_count = my_descriptor->counter;
       if(!locked && old_count < current) {
@@ -212,10 +215,13 @@ public:
         // descriptor, if any
         get_descriptor_pool().retire_acquired_result(my_descriptor, i_own,
                                                std::optional<RT>(result));
+        stats::count(stats::lock_acquired);
+        stats::record(stats::lock_retries, retries);
         return result;
       } else if (locked) {
         help_descriptor(current);
       }
+      retries++;
       current = read();
       locked = is_locked_(current);
     }
@@ -268,6 +274,7 @@ public:
 
     // retire the thunk
     get_descriptor_pool().retire_acquired_result(my_descriptor, i_own, result);
+    stats::count(result.has_value() ? stats::lock_acquired : stats::lock_failed);
     return result;
   }
 
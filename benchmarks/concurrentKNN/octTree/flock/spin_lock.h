@@ -87,13 +87,16 @@ public:
             lck = newl.release_lock();  // release lock
         }
         else *no_release = true;
+        stats::count(stats::lock_acquired);
         return std::optional<RT>(result); 
       } else {
+        stats::count(stats::lock_failed);
         return std::optional<RT>(); // fail
       }
     } else if (current.is_self_locked()) {// reentry
       return std::optional<RT>(f());
     } else {
+      stats::count(stats::lock_failed);
       return std::optional<RT>(); // fail
     }
   }
@@ -115,7 +118,12 @@ public:
     int delay = init_delay;
     long cnt = 0;
     while(true) {
-      if (try_lock_no_unlock()) return;
+      if (try_lock_no_unlock()) {
+        stats::count(stats::lock_acquired);
+        stats::record(stats::lock_retries, cnt);
+        return;
+      }
+      stats::count(stats::lock_failed);
       for (volatile int i=0; i < delay; i++);
       delay = std::min(2*delay, max_delay);
       if (cnt++ > 1000000)
@@ -140,11 +148,14 @@ public:
     const int init_delay = 100;
     const int max_delay = 2000;
     int delay = init_delay;
-    // int retrys = 0;
+    int retries = 0;
     while(true) {
       auto result = try_lock_result(f);
-      if(result.has_value()) return result.value();
-      // retrys++;
+      if(result.has_value()) {
+        stats::record(stats::lock_retries, retries);
+        return result.value();
+      }
+      retries++;
       for (volatile int i=0; i < delay; i++);
       delay = std::min(2*delay, max_delay);
     }
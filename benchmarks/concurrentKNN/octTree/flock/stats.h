@@ -0,0 +1,144 @@
+#pragma once
+
+// Contention and reclamation statistics for flock and verlib.
+// Compiled in with -DFlockStats, otherwise all calls are empty.
+
+// Public interface:
+//   stats::count(counter, v=1) : adds v to a counter
+//   stats::record(histogram, v) : adds v to a log2 histogram
+//   stats::clear() : zeros everything, only when no other thread is active
+//   stats::report() : prints the totals over all threads
+
+// Each thread updates its own slot (allocated on first use and never
+// freed), so updates are not shared, and the slots are summed when
+// reported.
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace flck {
+namespace stats {
+
+  enum counter {
+    lock_acquired,   // lock taken by a try_lock or with_lock
+    lock_failed,     // try_lock found the lock taken
+    help_attempted,  // lock-free lock tried to help the holder
+    help_succeeded,  // ... and ran its thunk
+    retired,         // objects retired to an epoch pool
+    reclaimed,       // retired objects freed
+    epoch_advanced,  // epoch increments
+    num_counters
+  };
+
+  enum histogram {
+    lock_retries,    // failed attempts before with_lock or try_loop succeeds
+    version_chain,   // versions skipped by a snapshot read
+    epoch_lag,       // how far the oldest announced epoch is behind
+                     // when the epoch cannot be advanced
+    reclaim_batch,   // objects freed at once when a thread's epoch advances
+    num_histograms
+  };
+
+#ifdef FlockStats
+
+  static constexpr int num_buckets = 32;
+
+  // bucket 0 holds 0, and bucket i holds [2^(i-1), 2^i)
+  inline int bucket(long v) {
+    int b = 0;
+    while (v > 0 && b < num_buckets - 1) {v >>= 1; b++;}
+    return b;
+  }
+
+  struct alignas(64) slot {
+    long counts[num_counters];
+    long buckets[num_histograms][num_buckets];
+    long sums[num_histograms];
+    long maxs[num_histograms];
+    slot() {clear();}
+    void clear() {
+      for (int i = 0; i < num_counters; i++) counts[i] = 0;
+      for (int h = 0; h < num_histograms; h++) {
+        for (int i = 0; i < num_buckets; i++) buckets[h][i] = 0;
+        sums[h] = maxs[h] = 0;
+      }
+    }
+  };
+
+  inline std::mutex& slots_lock() {static std::mutex m; return m;}
+  inline std::vector<slot*>& all_slots() {static std::vector<slot*> s; return s;}
+
+  inline slot* new_slot() {
+    slot* s = new slot();
+    std::lock_guard<std::mutex> g(slots_lock());
+    all_slots().push_back(s);
+    return s;
+  }
+
+  inline slot& my_slot() {
+    static thread_local slot* s = new_slot();
+    return *s;
+  }
+
+  inline void count(counter c, long v = 1) {my_slot().counts[c] += v;}
+
+  inline void record(histogram h, long v) {
+    slot& s = my_slot();
+    s.buckets[h][bucket(v)]++;
+    s.sums[h] += v;
+    s.maxs[h] = std::max(s.maxs[h], v);
+  }
+
+  inline void clear() {
+    std::lock_guard<std::mutex> g(slots_lock());
+    for (slot* s : all_slots()) s->clear();
+  }
+
+  inline void report() {
+    const char* counter_names[] = {
+      "lock acquired", "lock failed", "help attempted", "help succeeded",
+      "retired", "reclaimed", "epoch advanced"};
+    const char* histogram_names[] = {
+      "lock retries", "version chain", "epoch lag", "reclaim batch"};
+    slot total;
+    std::lock_guard<std::mutex> g(slots_lock());
+    for (slot* s : all_slots()) {
+      for (int i = 0; i < num_counters; i++) total.counts[i] += s->counts[i];
+      for (int h = 0; h < num_histograms; h++) {
+        for (int i = 0; i < num_buckets; i++) total.buckets[h][i] += s->buckets[h][i];
+        total.sums[h] += s->sums[h];
+        total.maxs[h] = std::max(total.maxs[h], s->maxs[h]);
+      }
+    }
+    std::cout << "flock stats over " << all_slots().size() << " threads" << std::endl;
+    for (int i = 0; i < num_counters; i++)
+      std::cout << "  " << counter_names[i] << ": " << total.counts[i] << std::endl;
+    std::cout << "  unreclaimed: "
+              << total.counts[retired] - total.counts[reclaimed] << std::endl;
+    for (int h = 0; h < num_histograms; h++) {
+      long n = 0;
+      for (int i = 0; i < num_buckets; i++) n += total.buckets[h][i];
+      std::cout << "  " << histogram_names[h] << ": count = " << n;
+      if (n == 0) {std::cout << std::endl; continue;}
+      std::cout << ", mean = " << total.sums[h] / ((double) n)
+                << ", max = " << total.maxs[h] << std::endl << "   ";
+      for (int i = 0; i < num_buckets; i++)
+        if (total.buckets[h][i] > 0)
+          std::cout << " <" << (1l << i) << ":" << total.buckets[h][i];
+      std::cout << std::endl;
+    }
+  }
+
+#else
+
+  inline void count(counter c, long v = 1) {}
+  inline void record(histogram h, long v) {}
+  inline void clear() {}
+  inline void report() {}
+
+#endif
+
+} // namespace stats
+} // namespace flck
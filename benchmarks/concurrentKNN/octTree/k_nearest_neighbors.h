@@ -466,6 +466,94 @@ node* find_leaf(node* T){ //takes in a point since interleave_bits() takes in a
       });
       return {ic, lc, std::move(rn.return_answer())};
   }
+
+  // Range count and report queries over a box or a ball.  Each runs on
+  // a snapshot, so with -DVersioned they are linearizable with
+  // concurrent inserts and deletes.  Subtrees inside the range are
+  // counted or reported without testing their points.
+  struct box_range {
+    box q;
+    bool intersects(box b) {
+      for (int i = 0; i < q.first.dimension(); i++)
+        if (b.first[i] > q.second[i] || b.second[i] < q.first[i]) return false;
+      return true;
+    }
+    bool contains(box b) {return within_box(q, b.first) && within_box(q, b.second);}
+    bool contains(point p) {return within_box(q, p);}
+  };
+
+  struct ball_range {
+    point c;
+    double r_sq;
+    bool intersects(box b) {return dist_sq_to_box(b, c) <= r_sq;}
+    bool contains(box b) { // the farthest corner is in the ball
+      double total = 0;
+      for (int i = 0; i < c.dimension(); i++) {
+        double d = std::max(c[i] - b.first[i], b.second[i] - c[i]);
+        total += d*d;
+      }
+      return total <= r_sq;
+    }
+    bool contains(point p) {return (p - c).sqLength() <= r_sq;}
+  };
+
+  template <typename Range>
+  static size_t range_count_rec(node* T, Range &R, bool inside) {
+    if (T == nullptr) return 0;
+    if (!inside) {
+      if (!R.intersects(T->Box())) return 0;
+      inside = R.contains(T->Box());
+    }
+    if (T->is_leaf()) {
+      auto &Vtx = T->Indexed_Pts();
+      if (inside) return Vtx.size();
+      size_t cnt = 0;
+      for (size_t i = 0; i < Vtx.size(); i++)
+        if (R.contains(Vtx[i].second->pt)) cnt++;
+      return cnt;
+    }
+    return (range_count_rec(T->Left(), R, inside) +
+            range_count_rec(T->Right(), R, inside));
+  }
+
+  template <typename Range>
+  static void range_report_rec(node* T, Range &R, bool inside,
+                               parlay::sequence<vtx*> &out) {
+    if (T == nullptr) return;
+    if (!inside) {
+      if (!R.intersects(T->Box())) return;
+      inside = R.contains(T->Box());
+    }
+    if (T->is_leaf()) {
+      auto &Vtx = T->Indexed_Pts();
+      for (size_t i = 0; i < Vtx.size(); i++)
+        if (inside || R.contains(Vtx[i].second->pt)) out.push_back(Vtx[i].second);
+    } else {
+      range_report_rec(T->Left(), R, inside, out);
+      range_report_rec(T->Right(), R, inside, out);
+    }
+  }
+
+  template <typename Range>
+  size_t range_count(Range R) {
+    return verlib::with_snapshot([&] {
+      return range_count_rec(tree.load(), R, false);});
+  }
+
+  // the output is rebuilt if a speculative snapshot (-DLazyStamp) is retried
+  template <typename Range>
+  parlay::sequence<vtx*> range_report(Range R) {
+    return verlib::with_snapshot([&] {
+      parlay::sequence<vtx*> out;
+      range_report_rec(tree.load(), R, false, out);
+      return out;});
+  }
+
+  size_t box_count(box q) {return range_count(box_range{q});}
+  parlay::sequence<vtx*> box_report(box q) {return range_report(box_range{q});}
+  size_t ball_count(point c, double rad) {return range_count(ball_range{c, rad*rad});}
+  parlay::sequence<vtx*> ball_report(point c, double rad) {
+    return range_report(ball_range{c, rad*rad});}
   
 
  
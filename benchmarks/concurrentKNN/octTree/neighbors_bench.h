@@ -111,7 +111,8 @@ void ANN(parlay::sequence<vtx*> &v, int k, int p, double trial_time, int update_
     knn_tree T(v_init, whole_box);
     // t.next("build tree");
    
-    // run benchmark
+    // run benchmark, only counting flock stats (-DFlockStats) from here
+    flck::stats::clear();
     t.start();
     auto start = std::chrono::system_clock::now();
     std::atomic<bool> finish = false;
@@ -184,6 +185,7 @@ void ANN(parlay::sequence<vtx*> &v, int k, int p, double trial_time, int update_
 
     if (report_stats) {
       std::cout << "depth = " << T.tree.load()->depth() << std::endl;
+      flck::stats::report();
     }
 };
 }
@@ -116,10 +116,13 @@ public:
     versioned* head_unmarked = strip_indirect(head);
 
     // chase down version chain
+    long hops = 0;
     while (head != nullptr && global_stamp.less(ls, head_unmarked->time_stamp.load())) {
       head = head_unmarked->next_version;
       head_unmarked = strip_indirect(head);
+      hops++;
     }
+    flck::stats::record(flck::stats::version_chain, hops);
 #ifdef LazyStamp
     if (head != nullptr && global_stamp.equal(head_unmarked->time_stamp.load(), ls)
 	&& speculative)
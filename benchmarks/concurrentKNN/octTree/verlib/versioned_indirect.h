@@ -65,8 +65,12 @@ public:
   
   V* read_snapshot() {
     version_link* head = set_stamp(v.load());
-    while (global_stamp.less(local_stamp, head->time_stamp.load()))
+    long hops = 0;
+    while (global_stamp.less(local_stamp, head->time_stamp.load())) {
       head = head->next_version;
+      hops++;
+    }
+    flck::stats::record(flck::stats::version_chain, hops);
 #ifdef LazyStamp
     if (global_stamp.equal(head->time_stamp.load(), local_stamp) && speculative)
       aborted = true;
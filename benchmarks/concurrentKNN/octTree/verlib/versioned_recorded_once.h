@@ -67,9 +67,12 @@ public:
     if(head == nullptr) return nullptr;
     set_stamp(head);
     TS ls = local_stamp;
+    long hops = 0;
     while (global_stamp.less(ls, head->time_stamp.load())) {
       head = (V*) head->next_version;
+      hops++;
     }
+    flck::stats::record(flck::stats::version_chain, hops);
 #ifdef LazyStamp
     if (global_stamp.equal(head->time_stamp.load(), ls) && speculative)
       aborted = true;
@@ -155,7 +155,8 @@ void ANN(parlay::sequence<vtx*> &v, int k, int p, double trial_time, int update_
 
    
    
-    // run benchmark
+    // run benchmark, only counting flock stats (-DFlockStats) from here
+    flck::stats::clear();
     t.start();
     auto start = std::chrono::system_clock::now();
     std::atomic<bool> finish = false;
@@ -265,6 +266,7 @@ void ANN(parlay::sequence<vtx*> &v, int k, int p, double trial_time, int update_
 
     if (report_stats) {
       std::cout << "depth = " << T.tree.load()->depth() << std::endl;
+      flck::stats::report();
     }
 };
 }
\ No newline at end of file
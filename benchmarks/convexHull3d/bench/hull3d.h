@@ -0,0 +1,10 @@
+// The interface for 3d convex hull
+// The result is a list of triangular facets, each given by three
+// indices into the input, ordered counterclockwise seen from outside
+#include "common/geometry.h"
+#include "parlay/primitives.h"
+
+using coord = double;
+using point = point3d<coord>;
+
+parlay::sequence<tri> hull3d(parlay::sequence<point> const &P);
@@ -0,0 +1 @@
+../bench/hull3d.h
\ No newline at end of file
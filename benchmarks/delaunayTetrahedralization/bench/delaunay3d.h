@@ -0,0 +1,10 @@
+// The inteface for delaunay tetrahedralization
+// The result includes four added points that form a bounding
+// tetrahedron, and the tetrahedra that touch them
+#include "common/geometry.h"
+#include "parlay/primitives.h"
+
+using coord = double;
+using point = point3d<coord>;
+
+tetrahedra<point> delaunay3d(parlay::sequence<point>& P);
@@ -0,0 +1 @@
+../bench/delaunay3d.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../delaunayTriangulation/incrementalDelaunay/neighbors.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../delaunayTriangulation/incrementalDelaunay/oct_tree.h
\ No newline at end of file
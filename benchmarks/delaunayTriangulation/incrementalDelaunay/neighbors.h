@@ -33,15 +33,27 @@ template <class vtx, int max_k>
 struct k_nearest_neighbors {
   using point = typename vtx::point_t;
   using fvect = typename point::vector;
-  using o_tree = oct_tree<vtx>;
+  using o_tree = oct_tree<vtx, 20>;
   using node = typename o_tree::node;
   using tree_ptr = typename o_tree::tree_ptr;
+  using box = typename o_tree::box;
 
   tree_ptr tree;
+  box tree_box;
 
   // generates the search structure
   k_nearest_neighbors(parlay::sequence<vtx*> &V) {
     tree = o_tree::build(V);
+    tree_box = tree->Box();
+  }
+
+  // generates an empty search structure with a fixed box, which must
+  // contain all points later added with insert
+  k_nearest_neighbors(box b) : tree_box(b) {}
+
+  // adds a batch of points to the search structure
+  void insert(parlay::sequence<vtx*> &V) {
+    o_tree::batch_insert(tree, V, tree_box);
   }
 
   // returns the vertices in the search structure, in an
@@ -150,7 +162,9 @@ struct k_nearest_neighbors {
       p->ngh[i] = nn[i];
   }
   
+  // null if empty
   vtx* nearest(vtx *p) {
+    if (tree == nullptr) return nullptr;
     kNN nn(p,1);
     nn.k_nearest_rec(tree.get());
     if (report_stats) p->counter = nn.internal_cnt;
@@ -0,0 +1 @@
+../../nearestNeighbors/octTree/oct_tree.h
\ No newline at end of file
@@ -0,0 +1,15 @@
+#include "parlay/primitives.h"
+
+using key_type = int;
+using key_value = std::pair<int,int>;
+
+// Merges the sorted sequences in Runs into one sorted sequence.
+parlay::sequence<key_type>
+multiway_merge(parlay::sequence<parlay::sequence<key_type>> const &Runs);
+
+// A and B are sorted by key (the first element).  For each key in both,
+// returns all pairs of a value from A and a value from B with that key,
+// as (value from A, value from B), in order of key.
+parlay::sequence<key_value>
+merge_join(parlay::sequence<key_value> const &A,
+	   parlay::sequence<key_value> const &B);
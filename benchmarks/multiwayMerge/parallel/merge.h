@@ -0,0 +1 @@
+../bench/merge.h
\ No newline at end of file
@@ -0,0 +1,225 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <algorithm>
+#include <limits>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "parlay/parallel.h"
+#include "parlay/primitives.h"
+
+// All k nearest neighbors, searching a leaf of queries at a time.
+// The points are copied in leaf order into one coordinate array per
+// dimension.  The queries of a leaf are searched together in blocks,
+// so each candidate leaf is visited once per block rather than once
+// per query, and distances from a query to a candidate leaf are
+// computed with SIMD over the coordinate arrays.  Each query keeps
+// its current k nearest in a fixed size array sorted by distance.
+// The dimension is a template argument so the loops over coordinates
+// are unrolled.  Requires k_nearest_neighbors.h to be included first.
+template <class vtx, int max_k, int dims>
+struct all_knn {
+  using knn_tree = k_nearest_neighbors<vtx, max_k>;
+  using node = typename knn_tree::node;
+  using box = typename knn_tree::box;
+  static constexpr int block_size = 32;  // queries searched together
+  static constexpr double infinity = std::numeric_limits<double>::max();
+
+  // the current k nearest of a query, nearest first, as indices
+  // into the leaf order
+  struct top_k {
+    double d[max_k];
+    long id[max_k];
+
+    void init(int k) {
+      for (int i = 0; i < k; i++) {d[i] = infinity; id[i] = -1;}
+    }
+
+    // assumes dist < d[k-1]
+    void insert(double dist, long j, int k) {
+      int i = k - 1;
+      for (; i > 0 && d[i-1] > dist; i--) {
+	d[i] = d[i-1];
+	id[i] = id[i-1];
+      }
+      d[i] = dist;
+      id[i] = j;
+    }
+  };
+
+  // a block of consecutive queries in leaf order and their bounding box
+  struct block {
+    top_k best[block_size];
+    size_t start;
+    int size;
+    double lo[dims], hi[dims];
+    double bound;  // the largest k-th distance in the block
+
+    void update_bound(int k) {
+      bound = 0.0;
+      for (int i = 0; i < size; i++) bound = std::max(bound, best[i].d[k-1]);
+    }
+  };
+
+  int k;
+  node* root;
+  parlay::sequence<vtx*> pts;
+  parlay::sequence<double> coords[dims];
+
+  all_knn(knn_tree &T, int k) : k(k), root(T.tree.get()) {
+    if (k > max_k) {
+      std::cout << "k too large in all_knn" << std::endl;
+      abort();
+    }
+    pts = T.vertices();
+    for (int d = 0; d < dims; d++)
+      coords[d] = parlay::tabulate(pts.size(), [&] (size_t i) {
+	  return pts[i]->pt[d];});
+  }
+
+  // squared distances from q to the points [s, e) in leaf order
+  void distances(const double* q, size_t s, size_t e, double* out) {
+    size_t i = s;
+#if defined(__AVX__)
+    for (; i + 4 <= e; i += 4) {
+      __m256d sum = _mm256_setzero_pd();
+      for (int d = 0; d < dims; d++) {
+	__m256d x = _mm256_sub_pd(_mm256_loadu_pd(coords[d].data() + i),
+				  _mm256_set1_pd(q[d]));
+	sum = _mm256_add_pd(sum, _mm256_mul_pd(x, x));
+      }
+      _mm256_storeu_pd(out + (i - s), sum);
+    }
+#elif defined(__SSE2__)
+    for (; i + 2 <= e; i += 2) {
+      __m128d sum = _mm_setzero_pd();
+      for (int d = 0; d < dims; d++) {
+	__m128d x = _mm_sub_pd(_mm_loadu_pd(coords[d].data() + i),
+			       _mm_set1_pd(q[d]));
+	sum = _mm_add_pd(sum, _mm_mul_pd(x, x));
+      }
+      _mm_storeu_pd(out + (i - s), sum);
+    }
+#endif
+    for (; i < e; i++) {
+      double sum = 0.0;
+      for (int d = 0; d < dims; d++) {
+	double x = coords[d][i] - q[d];
+	sum += x * x;
+      }
+      out[i - s] = sum;
+    }
+  }
+
+  // squared distance between the box [lo, hi] and the box b
+  double box_distance(const double* lo, const double* hi, box &b) {
+    double sum = 0.0;
+    for (int d = 0; d < dims; d++) {
+      double x = std::max(0.0, std::max(b.first[d] - hi[d], lo[d] - b.second[d]));
+      sum += x * x;
+    }
+    return sum;
+  }
+
+  // updates the queries in Q with the points of the leaf T, which
+  // starts at s in leaf order
+  void scan(node* T, size_t s, block &Q) {
+    size_t e = s + T->size();
+    box b = T->Box();
+    double dist[block_size];
+    for (int i = 0; i < Q.size; i++) {
+      size_t qi = Q.start + i;
+      double q[dims];
+      for (int d = 0; d < dims; d++) q[d] = coords[d][qi];
+      top_k &best = Q.best[i];
+      if (box_distance(q, q, b) >= best.d[k-1]) continue;
+      for (size_t c = s; c < e; c += block_size) {
+	size_t ce = std::min(e, c + block_size);
+	distances(q, c, ce, dist);
+	for (size_t j = c; j < ce; j++)
+	  if (dist[j - c] < best.d[k-1] && j != qi)
+	    best.insert(dist[j - c], j, k);
+      }
+    }
+    Q.update_bound(k);
+  }
+
+  // searches the subtree T, which starts at s in leaf order, visiting
+  // the closer child first
+  void search(node* T, size_t s, block &Q) {
+    box b = T->Box();
+    if (box_distance(Q.lo, Q.hi, b) >= Q.bound) return;
+    if (T->is_leaf()) scan(T, s, Q);
+    else {
+      node* L = T->Left();
+      node* R = T->Right();
+      box bl = L->Box();
+      box br = R->Box();
+      if (box_distance(Q.lo, Q.hi, br) < box_distance(Q.lo, Q.hi, bl)) {
+	search(R, s + L->size(), Q);
+	search(L, s, Q);
+      } else {
+	search(L, s, Q);
+	search(R, s + L->size(), Q);
+      }
+    }
+  }
+
+  // finds the neighbors of the queries [start, start + size)
+  void search_block(size_t start, int size) {
+    block Q;
+    Q.start = start;
+    Q.size = size;
+    for (int d = 0; d < dims; d++) {
+      Q.lo[d] = infinity;
+      Q.hi[d] = -infinity;
+      for (int i = 0; i < size; i++) {
+	Q.lo[d] = std::min(Q.lo[d], coords[d][start + i]);
+	Q.hi[d] = std::max(Q.hi[d], coords[d][start + i]);
+      }
+    }
+    for (int i = 0; i < size; i++) Q.best[i].init(k);
+    Q.bound = infinity;
+    search(root, 0, Q);
+    for (int i = 0; i < size; i++)
+      for (int j = 0; j < k; j++) {
+	long id = Q.best[i].id[j];
+	pts[start + i]->ngh[j] = (id == -1) ? nullptr : pts[id];
+      }
+  }
+
+  // processes the leaves in parallel
+  void run(node* T, size_t s) {
+    if (T->is_leaf()) {
+      size_t n = T->size();
+      for (size_t i = 0; i < n; i += block_size)
+	search_block(s + i, std::min<size_t>(block_size, n - i));
+    } else {
+      parlay::par_do_if(T->size() > 1000,
+			[&] () {run(T->Left(), s);},
+			[&] () {run(T->Right(), s + T->Left()->size());});
+    }
+  }
+
+  void run() {run(root, 0);}
+};
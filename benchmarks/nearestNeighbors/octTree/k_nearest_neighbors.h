@@ -122,7 +122,7 @@ struct k_nearest_neighbors {
       abort();
     }
     set_box(b);
-    tree = o_tree::build(V); 
+    tree = o_tree::build(V, b);
   }
 
 
@@ -333,9 +333,9 @@ node* find_leaf(point p, node* T, box b, double Delta){ //takes in a point since
   //then, we use this interleave integer to find the correct leaf
   while (not (current->is_leaf())){
     if(lookup_bit(searchInt, current -> bit) == 0){ 
-      current = current->Right(); 
+      current = current->Left(); 
     } else{
-      current = current->Left();
+      current = current->Right();
     }
   };
   return current;
@@ -383,144 +383,14 @@ void k_nearest_leaf(vtx* p, node* T, int k) {
 
     using indexed_point = typename o_tree::indexed_point; 
 
-  indexed_point get_point(node* T){
-    if (T->is_leaf()){
-      return (T->indexed_pts)[0];
-    } else{
-      return get_point(T->Left());
-    }
-  }
-
-  void batch_insert0(slice_t idpts, node* T, int bit){
-    if (idpts.size()==0) return;
-    T->set_flag(true);
-    if(T->is_leaf()){
-      if(T->size() + idpts.size() < o_tree::node_cutoff || T->bit == 0){
-        // std::cout << "batch update" << std::endl;
-        T->batch_update(idpts); 
-        // std::cout << "batch update done" << std::endl;
-      } else{    
-        // std::cout << "batch split" << std::endl;
-        o_tree::batch_split(idpts, T, bit);
-        // std::cout << "batch split done" << std::endl;
-      }
-    } else{
-        // std::cout << "internal" << std::endl;
-        //reset size of parent, and cut points based on bit of T
-        // int new_bit = T->bit; 
-        size_t val = ((size_t) 1) << (bit - 1);
-        size_t mask = (bit == 64) ? ~((size_t) 0) : ~(~((size_t) 0) << bit);
-        auto less = [&] (indexed_point x) {
-          return (x.first & mask) < val;
-        };
-        int cut_point = parlay::internal::binary_search(idpts, less);
-        // std::cout << "internal sorted" << std::endl;
-        if(bit > T->bit){ // T cannot be root due to enforced condition in batch_insert()
-          std::cout << "create new" << std::endl;
-          indexed_point sample = get_point(T);
-          int sample_pos = lookup_bit(sample.first, bit);
-          if(sample_pos == 0){ // T and descendants are in left half
-            o_tree::create_new(T, idpts.cut(cut_point, idpts.size()), bit, false);
-            batch_insert0(idpts.cut(0, cut_point), T, bit-1);
-          }else{ // T and descendants are in right half
-            o_tree::create_new(T, idpts.cut(0, cut_point), bit, true);
-            batch_insert0(idpts.cut(cut_point, idpts.size()), T, bit-1);
-          }
-        } else{
-          // std::cout << "standard recursion" << std::endl;
-          T->set_size(T->size()+idpts.size());
-          parlay::par_do_if(idpts.size() > 100,
-            [&] () {batch_insert0(idpts.cut(0, cut_point), T->Left(), bit-1);},
-            [&] () {batch_insert0(idpts.cut(cut_point, idpts.size()), T->Right(), bit-1);}
-          );
-        }
-    }
+  // batch updates, which require the tree to have been built with a
+  // box that contains all points that will be inserted
+  void batch_insert(parlay::sequence<vtx*> &V) {
+    o_tree::batch_insert(tree, V, tree_box);
   }
 
-  void batch_insert(parlay::sequence<vtx*> v, node* R, box b, double Delta){
-    size_t vsize = v.size();
-    //make sure all the points are within the bounding box of the initial tree
-    box points_box = o_tree::get_box(v);
-    int dims = v[0]->pt.dimension();
-    bool ll_bad = false;
-    bool ur_bad = false;
-    for(int i=0; i<dims; i++){
-      if(points_box.first[i] < b.first[i]){
-        ll_bad = true;
-      }
-      if(points_box.second[i] > b.second[i]){
-        ur_bad = true;
-      }
-    }
-    if(ll_bad || ur_bad){
-      std::cout << "ERROR: points not contained in bounding box of data structure" << std::endl;
-      abort();
-    }
-    parlay::sequence<indexed_point> idpts; 
-    idpts = parlay::sequence<indexed_point>(vsize);
-    auto points = parlay::tabulate(vsize, [&] (size_t i) -> indexed_point {
-      return std::make_pair(o_tree::interleave_bits(v[i]->pt, b.first, Delta), v[i]);
-    });
-    auto less = [] (indexed_point a, indexed_point b){
-      return a.first < b.first; 
-    };
-    auto x = parlay::sort(points, less);
-    std::cout << "sorted" << std::endl;
-    batch_insert0(parlay::make_slice(x), R, R->bit);
-    std::cout << "inserted" << std::endl;
-    box root_box = o_tree::update_boxes(R);
-    std::cout << "updated boxes" << std::endl;
-  }
-
-  void batch_delete0(slice_t idpts, node* R){
-    if(idpts.size()==0) return;
-    R->set_flag(true);
-    if(R->is_leaf()){
-      size_t n = idpts.size();
-      if(n == R->size()){
-        o_tree::prune(R); //TODO this might leave R's parent with wrong bit
-      }else{
-        R->batch_remove(idpts);
-      }
-    } else{
-      size_t n = idpts.size();
-      if(n == R->size()){
-        o_tree::prune(R);
-      } else{
-        R->set_size(R->size()-n);
-        int new_bit = R->bit; 
-        size_t val = ((size_t) 1) << (new_bit - 1);
-        size_t mask = (new_bit == 64) ? ~((size_t) 0) : ~(~((size_t) 0) << new_bit);
-        auto less = [&] (indexed_point x) {
-          return (x.first & mask) < val;
-        };
-        int cut_point = parlay::internal::binary_search(idpts, less);
-        parlay::par_do_if(n > 100,
-          [&] () {batch_delete0(idpts.cut(0, cut_point), R->Left());},
-          [&] () {batch_delete0(idpts.cut(cut_point, n), R->Right());}
-        );
-      }
-    }
-  }
-
-  void batch_delete(parlay::sequence<vtx*> v, node* R, box b, double Delta){
-    size_t vsize = v.size();
-    parlay::sequence<indexed_point> idpts; 
-    idpts = parlay::sequence<indexed_point>(vsize);
-    auto points = parlay::delayed_seq<indexed_point>(vsize, [&] (size_t i) -> indexed_point {
-      return std::make_pair(o_tree::interleave_bits(v[i]->pt, b.first, Delta), v[i]);
-    });
-    auto less = [] (indexed_point a, indexed_point b){
-      return a.first < b.first; 
-    };
-    auto x = parlay::sort(points, less); 
-    // std::cout << "sorted" << std::endl;
-    batch_delete0(parlay::make_slice(x), R);
-    // std::cout << "deleted" << std::endl;
-    o_tree::compress(R);  
-    // std::cout << "pruned" << std::endl;
-    box root_box = o_tree::update_boxes(R);
-    // std::cout << "updated boxes" << std::endl;
+  void batch_delete(parlay::sequence<vtx*> &V) {
+    o_tree::batch_delete(tree, V, tree_box);
   }
 
 }; //this ends the k_nearest_neighbors structure
@@ -22,7 +22,8 @@
 
 bool report_stats = false;
 int algorithm_version = 2;
-// 0=root based, 1=bit based, >2=map based
+// 0=root based, 1=bit based, 2=map based, 3=batch dynamic,
+// 4=all kNN by leaves
 
 #include <algorithm>
 #include <math.h> 
@@ -31,6 +32,50 @@ int algorithm_version = 2;
 #include "parlay/primitives.h"
 #include "common/geometry.h"
 #include "k_nearest_neighbors.h"
+#include "all_knn.h"
+
+// Interleaves batches of updates with batches of queries.  It starts
+// with a tree on the first half of the points, and in each round
+// inserts a batch of the second half, deletes a batch of the first
+// half, and finds the neighbors of the points just inserted.  At the
+// end the deleted points are put back and the neighbors of all points
+// are found, so the output is the same as for the static versions.
+template <int max_k, class vtx, class box>
+void batch_dynamic_ANN(parlay::sequence<vtx*> &v, int k, box whole_box) {
+  timer t("dynamic ANN", report_stats);
+  using knn_tree = k_nearest_neighbors<vtx, max_k>;
+  using node = typename knn_tree::node;
+  size_t n = v.size();
+  size_t num_rounds = 10;
+  size_t half = (n + 1) / 2;
+  size_t insert_size = (n - half + num_rounds - 1) / num_rounds;
+  size_t delete_size = half / num_rounds;
+
+  auto initial = parlay::to_sequence(v.cut(0, half));
+  knn_tree T(initial, whole_box);
+  t.next("build tree");
+
+  for (size_t r = 0; r < num_rounds; r++) {
+    size_t s = std::min(n, half + r * insert_size);
+    size_t e = std::min(n, s + insert_size);
+    auto inserts = parlay::to_sequence(v.cut(s, e));
+    T.batch_insert(inserts);
+    auto deletes = parlay::to_sequence(v.cut(r * delete_size, (r + 1) * delete_size));
+    T.batch_delete(deletes);
+    node* root = T.tree.get();
+    auto bd = T.get_box_delta(v[0]->pt.dimension());
+    parlay::parallel_for(s, e, [&] (size_t i) {
+      T.k_nearest_leaf(v[i], T.find_leaf(v[i]->pt, root, bd.first, bd.second), k);}, 1);
+  }
+  t.next("update and query rounds");
+
+  auto deleted = parlay::to_sequence(v.cut(0, num_rounds * delete_size));
+  T.batch_insert(deleted);
+  t.next("reinsert");
+
+  T.tree->map([&] (vtx* p, node* n) {T.k_nearest_leaf(p, n, k);});
+  t.next("try all");
+}
 
 // find the k nearest neighbors for all points in tree
 // places pointers to them in the .ngh field of each vertex
@@ -46,43 +91,15 @@ void ANN(parlay::sequence<vtx*> &v, int k) {
   
     box whole_box = knn_tree::o_tree::get_box(v);
 
-    // create sequences for insertion and deletion
-    // size_t size = v.size(); 
-    // size_t p = .5*size;
-    // parlay::sequence<vtx*> v1 = parlay::sequence<vtx*>(p);
-    // parlay::sequence<vtx*> v2 = parlay::sequence<vtx*>(p);
-    // parlay::parallel_for(0, size, [&] (size_t i){
-    //   if(i<p) v1[i] = v[i];
-    //   else v2[i-p] = v[i];
-    // }, 1
-    // );
+    if (algorithm_version == 3) {
+      batch_dynamic_ANN<max_k>(v, k, whole_box);
+      return;
+    }
 
     //build tree with optional box
     knn_tree T(v, whole_box);
     t.next("build tree");
 
-    //prelims for insert/delete
-    int dims = v[0]->pt.dimension();
-    node* root = T.tree.get();
-    box_delta bd = T.get_box_delta(dims);
-
-    t.next("get box");
-    // batch-dynamic deletion
-    //T.batch_delete(v2, root, bd.first, bd.second);
-    //t.next("batch deletion");
-
-    // batch-dynamic insertion
-    //T.batch_insert(v2, root, bd.first, bd.second);
-    //t.next("batch insertion");
-
-    //knn_tree R(v, whole_box);
-    //t.next("build comparison tree");
-
-    // T.are_equal(R.tree.get(), dims);
-    //  t.next("equality check");
-
-
-
     if (report_stats) 
       std::cout << "depth = " << T.tree->depth() << std::endl;
 
@@ -111,6 +128,15 @@ void ANN(parlay::sequence<vtx*> &v, int k) {
         );
 
 
+    } else if (algorithm_version == 4) {
+        if (v[0]->pt.dimension() == 2) {
+          all_knn<vtx, max_k, 2> A(T, k);
+          A.run();
+        } else {
+          all_knn<vtx, max_k, 3> A(T, k);
+          A.run();
+        }
+
     } else { //(algorithm_version == 2) this is for starting from leaf, finding leaf using map()
         auto f = [&] (vtx* p, node* n){ 
   	     return T.k_nearest_leaf(p, n, k); 
@@ -32,7 +32,8 @@
 // and v->pt must support pt.dimension(), pt[i],
 //    (pt1 - pt2).Length(), pt1 + (pt2 - pt3)
 //    pt1.minCoords(pt2), pt1.maxCoords(pt2),
-template <typename vtx>
+// leaf_size is the number of points below which a subtree is a leaf
+template <typename vtx, int leaf_size = 32>
 struct oct_tree {
 
   using point = typename vtx::pointT;
@@ -42,7 +43,7 @@ struct oct_tree {
   using slice_t = decltype(make_slice(parlay::sequence<indexed_point>()));
   using slice_v = decltype(make_slice(parlay::sequence<vtx*>()));
 
-  constexpr static int node_cutoff = 32;
+  constexpr static int node_cutoff = leaf_size;
 
 
   
@@ -89,7 +90,6 @@ struct oct_tree {
   struct node { 
 
   public:
-    bool flag = false; 
     int bit;
     parlay::sequence<indexed_point> indexed_pts;
     using leaf_seq = parlay::sequence<vtx*>;
@@ -102,13 +102,6 @@ struct oct_tree {
     node* Parent() {return parent;}
     leaf_seq& Vertices() {return P;}
 
-    //the flag is for the batch dynamic updates
-    //it keeps track of whether a node has been updated or not
-    //so that we can go back and fix boxes etc where necessary
-    void set_flag(bool new_flag){
-      flag = new_flag; 
-    }
-
     void set_bit(int currentBit){
       bit = currentBit;
     }
@@ -152,14 +145,13 @@ struct oct_tree {
       else R = child;
     }
 
-    void batch_update(slice_t new_points){
-      int new_size = new_points.size();
-      for(size_t i=0; i<new_size; i++){
-        indexed_pts.push_back(new_points[i]);
-        P.push_back(new_points[i].second);
-      }
-      n += new_size;
-      b = get_box(P);
+    // sets both children, and the size and box from them
+    void set_children(node* l, node* r){
+      L = l; R = r;
+      L->parent = R->parent = this;
+      n = L->size() + R->size();
+      b = box(L->b.first.minCoords(R->b.first),
+	      L->b.second.maxCoords(R->b.second));
       set_center();
     }
 
@@ -180,34 +172,6 @@ struct oct_tree {
       for(size_t i=0; i<v.size(); i++) print_point(v[i].second->pt);
     }
 
-    bool are_equal(point p, point q, int d){
-      for(int i=0; i<d; i++){
-        if(p[i] != q[i]) return false;
-      }
-      return true;
-    }
-
-    void batch_remove(slice_t points_to_delete){
-      int deleted_size = points_to_delete.size();
-      parlay::sequence<bool> indices_to_retain(P.size(), true);
-      for(size_t i=0; i<deleted_size; i++){
-        for(size_t j=0; j<P.size(); j++){
-          if(are_equal(points_to_delete[i].second->pt, P[j]->pt, P[j]->pt.dimension())){
-            indices_to_retain[j]=false;
-            break;
-          }
-        }
-      }
-      auto new_P = parlay::pack(P, indices_to_retain);
-      P = new_P;
-      auto new_idpts = parlay::pack(indexed_pts, indices_to_retain);
-      indexed_pts = new_idpts;
-      n -= deleted_size;
-      b = get_box(P);
-      set_center();
-    }
-
-
     // construct a leaf node with a sequence of points directly in it
     node(slice_t Pts, int currentBit) { 
       n = Pts.size();
@@ -263,6 +227,13 @@ struct oct_tree {
       return r;
     }
 
+    // the tagged points in the leaves, in key order
+    parlay::sequence<indexed_point> flatten_indexed() {
+      parlay::sequence<indexed_point> r(n);
+      flatten_indexed_rec(this, parlay::make_slice(r));
+      return r;
+    }
+
     // map a function f(p,node_ptr) over the points, passing
     // in a pointer to a vertex, and a pointer to the leaf node it is in.
     // f should return void
@@ -323,6 +294,19 @@ struct oct_tree {
       centerv = b.first + (b.second-b.first)/2;
     }
 
+    static void flatten_indexed_rec(node *T, slice_t R) {
+      if (T->is_leaf())
+	for (int i=0; i < T->size(); i++)
+	  R[i] = T->indexed_pts[i];
+      else {
+	size_t n_left = T->L->size();
+	size_t n = T->size();
+	parlay::par_do_if(n > 1000,
+	  [&] () {flatten_indexed_rec(T->L, R.cut(0, n_left));},
+	  [&] () {flatten_indexed_rec(T->R, R.cut(n_left, n));});
+      }
+    }
+
     static void flatten_rec(node *T, slice_v R) {
       if (T->is_leaf())
 	for (int i=0; i < T->size(); i++)
@@ -338,109 +322,6 @@ struct oct_tree {
   }; // this ends the node structure
 
 
-    //takes in a sequence of points and a leaf node and splits based on the leaf node
-    //TODO fix edge case where T has no parent 
-    static void batch_split(slice_t new_points, node* T, int bit){
-      //get the new sequence of indexed points and sort it
-      int size = T->size();
-      int new_size = new_points.size();
-      parlay::sequence<indexed_point> indexed_points;
-      indexed_points = parlay::sequence<indexed_point>(size+new_size);
-      for(size_t i=0; i<size; i++){
-        indexed_points[i] = (T->indexed_pts)[i];
-      }
-      for(size_t i=0; i<new_size; i++){
-        indexed_points[size+i] = new_points[i];
-      }
-      auto less = [] (indexed_point a, indexed_point b){
-        return a.first < b.first; 
-      };
-      auto x = parlay::sort(indexed_points, less);
-      //get a new tree based on the sorted sequence
-      node* parent = build_recursive(parlay::make_slice(x), bit);
-      // std::cout << "built tree" << std::endl;
-      //set everyone's parent pointers and delete the old node
-      node* grandparent = T->Parent();
-      if(grandparent->Left() == T) grandparent->set_child(parent, true);
-      else grandparent->set_child(parent, false);
-      parent->set_parent(grandparent);
-      T->set_parent(nullptr);
-      node::delete_tree(T);
-    }
-
-    //occasionally, inserting a point will require not splitting an existing node but creating a new one
-    //this function creates the new node and a new intermediate node
-    static void create_new(node* T, slice_t indexed_points, int bit, bool points_left){
-      if (indexed_points.size() == 0) return; 
-      node* new_int = build_recursive(indexed_points, bit-1);
-      node* T_parent = T->Parent();
-      node* intermediate;
-      if(points_left) intermediate = node::new_node(new_int, T, bit);
-      else intermediate = node::new_node(T, new_int, bit);
-      intermediate->set_parent(T_parent);
-      bool T_left = (T == T_parent->Left());
-      T_parent->set_child(intermediate, T_left);
-      T_parent->set_size(T_parent->Left()->size() + T_parent->Right()->size());
-    }
-
-    //delete a node and all its children
-    //replace the node's parent with its other child
-    //must then also set the grandparent's pointer correctly
-    static void prune(node* T){
-      if(T->Parent() == nullptr || (T->Parent())->Parent() == nullptr){
-        std::cout << "ERROR: deleting the root or one of its two children is not supported" << std::endl;
-        abort(); 
-      } 
-      if(T == (T->Parent())->Left()) (T->Parent())->set_child(nullptr, true);
-      else (T->Parent())->set_child(nullptr, false);
-      node::delete_tree(T);
-    }
-
-    //gets rid of any nodes which only have one child due to pruning
-    //can assume due to constraints on prune() that the deleted node has a parent
-    static void compress(node* T){
-      if(T->is_leaf()) return;
-      if(T->flag == false) return; 
-      if((T->Left() != nullptr) && (T->Right() != nullptr)){
-        parlay::par_do_if(T->size()>1000,
-          [&] () {compress(T->Right());},
-          [&] () {compress(T->Left());}
-        );
-      }else{
-        node* grandparent = T->Parent();
-        node* T_replacement;
-        if(T->Left() == nullptr){
-          T_replacement = T->Right();
-          T -> set_child(nullptr, false);
-        } else if(T->Right() == nullptr){ //the right child of T is the nullptr
-          T_replacement = T->Left();
-          T -> set_child(nullptr, true);
-        }
-        T_replacement -> set_parent(grandparent);
-        if(T == grandparent -> Left()) grandparent -> set_child(T_replacement, true);
-        else grandparent -> set_child(T_replacement, false);
-        node::delete_tree(T);
-        compress(T_replacement);
-      }  
-    }
-
-    static void verify_compress(node* T){
-      if((T->Left() == nullptr) && (T->Right() == nullptr)) return;
-      else if((T->Left() != nullptr) && (T->Right() != nullptr)){
-        verify_compress(T->Left());
-        verify_compress(T->Right());
-      } else{
-        if((T->Left() == nullptr) && (T->Right() != nullptr)){
-           verify_compress(T->Right());
-        } else if((T->Left() != nullptr) && (T->Right() == nullptr)){
-           verify_compress(T->Left());
-        }
-        std::cout << "ERROR: node with only one nullptr child exists in tree" << std::endl; 
-        abort();
-      }
-
-    }
-
     static void verify_parents0(node* T){
       if(T->Parent() == nullptr){
         std::cout << "ERROR: parent of a non-root node is null" << std::endl; 
@@ -456,32 +337,6 @@ struct oct_tree {
       verify_parents0(T->Right());
     }
 
-    static box update_boxes(node* T){
-      if(T->flag == false){ //if the node was not traversed during the update, stop recursing
-        // std::cout << "here" << std::endl; 
-        return T->Box();
-      }
-      if (T->is_leaf()){
-        return T->Box();
-        T->set_flag(false);
-      } else{
-        size_t n = T->size();
-        box b_L, b_R;
-        parlay::par_do_if(n > 1000,
-          [&] () {b_L = update_boxes(T->Left());},
-          [&] () {b_R = update_boxes(T->Right());} 
-        );
-        box b_T = box(b_L.first.minCoords(b_R.first), b_L.second.maxCoords(b_R.second));
-        T->set_box(b_T);
-        T->reset_center();
-        T->set_flag(false);
-        return b_T;
-      }
-    }
-
-
-
-  
   // A unique pointer to a tree node to ensure the tree is
   // destructed when the pointer is, and that  no copies are made.
   struct delete_tree {void operator() (node *T) const {node::delete_tree(T);}};
@@ -515,6 +370,40 @@ struct oct_tree {
     return tag_points(V);
   }
 
+  // *************************************************************
+  //    BATCH UPDATES
+  // *************************************************************
+
+  // Inserts or deletes a batch of points in a tree that was built with
+  // build(P, b), so that the keys of new points line up with those
+  // already there.  The points must be inside b, and deleted points
+  // are matched by pointer.  Only the paths to the leaves that receive
+  // points are touched: a leaf that grows past node_cutoff is rebuilt
+  // from its points, and a subtree that shrinks below it is collapsed
+  // into a leaf, so the tree stays as it would be if built from
+  // scratch up to where empty nodes are removed.  The tree can become
+  // empty (null), and insertion into an empty tree builds it.
+  template <typename Seq>
+  static void batch_insert(tree_ptr &T, Seq &V, box b) {
+    if (V.size() == 0) return;
+    int dims = (V[0]->pt).dimension();
+    check_inside(V, b);
+    auto pts = tag_points(V, b);
+    node* r = insert_recursive(T.release(), make_slice(pts), dims*(key_bits/dims));
+    r->set_parent(nullptr);
+    T.reset(r);
+  }
+
+  template <typename Seq>
+  static void batch_delete(tree_ptr &T, Seq &V, box b) {
+    if (V.size() == 0 || T == nullptr) return;
+    int dims = (V[0]->pt).dimension();
+    auto pts = tag_points(V, b);
+    node* r = delete_recursive(T.release(), make_slice(pts), dims*(key_bits/dims));
+    if (r != nullptr) r->set_parent(nullptr);
+    T.reset(r);
+  }
+
 private:
   constexpr static int key_bits = 64;
  
@@ -569,6 +458,129 @@ private:
     return x;
   }
 
+  template <typename Seq>
+  static void check_inside(Seq &V, box b) {
+    box vb = get_box(V);
+    for (int i = 0; i < (V[0]->pt).dimension(); i++)
+      if (vb.first[i] < b.first[i] || vb.second[i] > b.second[i]) {
+	std::cout << "oct_tree: points not contained in the box of the tree" << std::endl;
+	abort();
+      }
+  }
+
+  // the key of some point in the subtree, all of which agree with it
+  // from T->bit upwards
+  static size_t sample_key(node* T) {
+    while (!T->is_leaf()) T = T->Left();
+    return T->indexed_pts[0].first;
+  }
+
+  // the position of the first point whose key has a 1 at position b,
+  // for points sorted by key that agree above b
+  static size_t split_point(slice_t Pts, int b) {
+    return parlay::internal::binary_search(Pts, [&] (indexed_point x) {
+	return ((x.first >> b) & 1) == 0;});
+  }
+
+  // Inserts the sorted points Pts into the subtree T and returns the
+  // new root of the subtree.  All keys in T and Pts agree from bit
+  // upwards.
+  static node* insert_recursive(node* T, slice_t Pts, int bit) {
+    size_t n = Pts.size();
+    if (n == 0) return T;
+    if (T == nullptr) return build_recursive(Pts, bit);
+    if (T->is_leaf()) {
+      auto less = [] (indexed_point a, indexed_point b) {
+	return a.first < b.first;};
+      auto pts = parlay::merge(T->indexed_pts, Pts, less);
+      node::delete_tree(T);
+      return build_recursive(make_slice(pts), bit);
+    }
+
+    // T skips the bits from bit down to T->bit since all its keys
+    // agree on them.  If some new points do not, they go in a new
+    // subtree next to T.
+    size_t key = sample_key(T);
+    for (int b = bit - 1; b >= T->bit; b--) {
+      size_t pos = split_point(Pts, b);
+      bool T_left = ((key >> b) & 1) == 0;
+      slice_t same = T_left ? Pts.cut(0, pos) : Pts.cut(pos, n);
+      slice_t other = T_left ? Pts.cut(pos, n) : Pts.cut(0, pos);
+      if (other.size() > 0) {
+	node *S, *R;
+	parlay::par_do_if(n > 1000,
+	  [&] () {S = build_recursive(other, b);},
+	  [&] () {R = insert_recursive(T, same, b);});
+	return T_left ? node::new_node(R, S, b + 1) : node::new_node(S, R, b + 1);
+      }
+    }
+
+    int b = T->bit - 1;
+    size_t pos = split_point(Pts, b);
+    node *L, *R;
+    parlay::par_do_if(n > 1000,
+      [&] () {L = insert_recursive(T->Left(), Pts.cut(0, pos), b);},
+      [&] () {R = insert_recursive(T->Right(), Pts.cut(pos, n), b);});
+    T->set_children(L, R);
+    return T;
+  }
+
+  // Deletes the sorted points Pts from the subtree T and returns the
+  // new root of the subtree, or null if it is empty.  Points that are
+  // not in the tree are ignored.
+  static node* delete_recursive(node* T, slice_t Pts, int bit) {
+    size_t n = Pts.size();
+    if (n == 0 || T == nullptr) return T;
+    if (T->is_leaf()) {
+      auto ptrs = parlay::sort(parlay::delayed_seq<vtx*>(n, [&] (size_t i) {
+	    return Pts[i].second;}));
+      auto keep = parlay::filter(T->indexed_pts, [&] (indexed_point x) {
+	  return !std::binary_search(ptrs.begin(), ptrs.end(), x.second);});
+      if (keep.size() == T->size()) return T;
+      int b = T->bit;
+      node::delete_tree(T);
+      if (keep.size() == 0) return nullptr;
+      return node::new_leaf(make_slice(keep), b);
+    }
+
+    // only points that agree with the keys of T on the bits it skips
+    // can be in it
+    int b = T->bit - 1;
+    parlay::sequence<indexed_point> in_T;
+    if (T->bit < bit) {
+      size_t prefix = sample_key(T) >> T->bit;
+      in_T = parlay::filter(Pts, [&] (indexed_point x) {
+	  return (x.first >> T->bit) == prefix;});
+      Pts = make_slice(in_T);
+      n = Pts.size();
+      if (n == 0) return T;
+    }
+
+    size_t pos = split_point(Pts, b);
+    node *L, *R;
+    parlay::par_do_if(n > 1000,
+      [&] () {L = delete_recursive(T->Left(), Pts.cut(0, pos), b);},
+      [&] () {R = delete_recursive(T->Right(), Pts.cut(pos, n), b);});
+    T->set_child(nullptr, true);
+    T->set_child(nullptr, false);
+
+    // replace T by its remaining child, or by a leaf if small
+    if (L == nullptr || R == nullptr) {
+      node::delete_tree(T);
+      return (L == nullptr) ? R : L;
+    }
+    if (L->size() + R->size() < node_cutoff) {
+      auto pts = parlay::append(L->flatten_indexed(), R->flatten_indexed());
+      int tb = T->bit;
+      node::delete_tree(L);
+      node::delete_tree(R);
+      node::delete_tree(T);
+      return node::new_leaf(make_slice(pts), tb);
+    }
+    T->set_children(L, R);
+    return T;
+  }
+
   // each point is a pair consisting of an interleave integer along with
   // the pointer to the point.   The bit specifies which bit of the integer
   // we are working on (starts at top, and goes down).
@@ -613,12 +625,14 @@ private:
 
   // uses the parlay memory manager, could be replaced will alloc/free
 
-template <typename vtx>
-parlay::type_allocator<typename oct_tree<vtx>::node> node_allocator;
+template <typename vtx, int leaf_size>
+parlay::type_allocator<typename oct_tree<vtx,leaf_size>::node> node_allocator;
 
-template <typename vtx>
-typename oct_tree<vtx>::node* oct_tree<vtx>::node::alloc_node() { return node_allocator<vtx>.alloc();}
+template <typename vtx, int leaf_size>
+typename oct_tree<vtx,leaf_size>::node* oct_tree<vtx,leaf_size>::node::alloc_node() {
+  return node_allocator<vtx,leaf_size>.alloc();}
 
-template <typename vtx>
-void oct_tree<vtx>::node::free_node(node* T) { node_allocator<vtx>.free(T);}
+template <typename vtx, int leaf_size>
+void oct_tree<vtx,leaf_size>::node::free_node(node* T) {
+  node_allocator<vtx,leaf_size>.free(T);}
   
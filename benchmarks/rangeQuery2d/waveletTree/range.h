@@ -0,0 +1 @@
+../bench/range.h
\ No newline at end of file
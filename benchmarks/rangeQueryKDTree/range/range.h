@@ -62,7 +62,8 @@ void write_range_result(char* outFile, parlay::sequence<parlay::sequence<int>> &
 // find the k nearest neighbors for all points in tree
 // places pointers to them in the .ngh field of each vertex
 template <class vtx>
-void RANGE(parlay::sequence<vtx*> &v, double rad, int p, double trial_time, int update_percent) {
+void RANGE(parlay::sequence<vtx*> &v, double rad, int p, double trial_time, int update_percent,
+           int query_type) {
   timer t("RANGE",report_stats);
 
   {
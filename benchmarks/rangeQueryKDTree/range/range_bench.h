@@ -37,10 +37,13 @@ g++-11 -DHOMEGROWN -pthread -mcx16 -g -std=c++17 -I .  -include neighbors.h -o n
 ASAN_OPTIONS=detect_leaks=0 PARLAY_NUM_THREADS=72 numactl -i all ./neighbors_debug -d 2 -k 1 -o oFile ../geometryData/data/2DinCube_10M
 */
 
-// find the k nearest neighbors for all points in tree
-// places pointers to them in the .ngh field of each vertex
+// Mixes inserts and deletes with range queries around random points.
+// query_type: 0=ball report (excluding the point), 1=ball count,
+// 2=box report, 3=box count, 4=all of them in turn.  Boxes have half
+// width rad.
 template <class vtx>
-void RANGE(parlay::sequence<vtx*> &v, double rad, int p, double trial_time, int update_percent) {
+void RANGE(parlay::sequence<vtx*> &v, double rad, int p, double trial_time, int update_percent,
+           int query_type) {
   timer t("ANN",report_stats);
 
   {
@@ -71,6 +74,8 @@ void RANGE(parlay::sequence<vtx*> &v, double rad, int p, double trial_time, int
     std::cout << "threads: " << p << std::endl;
     std::cout << "update_percent: " << update_percent << std::endl;
     std::cout << "query radius: " << rad << std::endl;
+    const char* query_names[] = {"ball report", "ball count", "box report", "box count", "mixed"};
+    std::cout << "query type: " << query_names[query_type] << std::endl;
     std::cout << "trial_time: " << trial_time << std::endl;
 
     //calculate bounding box around the whole point set
@@ -138,10 +143,27 @@ void RANGE(parlay::sequence<vtx*> &v, double rad, int p, double trial_time, int
         } else if (op_type < update_percent) { 
           if(T.delete_point(v[idx])) added--;
           else del_failed++; 
-        } else { 
+        } else {
+          int qt = (query_type == 4) ? total % 4 : query_type;
+          point c = v[idx]->pt;
+          double lo[3] = {0.0, 0.0, 0.0}, hi[3] = {0.0, 0.0, 0.0};
+          for (int j = 0; j < c.dimension(); j++) {
+            lo[j] = c[j] - rad;
+            hi[j] = c[j] + rad;
+          }
+          box q = box(point(parlay::make_slice(lo, lo + 3)),
+                      point(parlay::make_slice(hi, hi + 3)));
+          if (qt == 0) {
             auto ans = T.range_search(v[idx], rad);
             visited_stats[i].push_back(std::get<1>(ans)); 
             size_stats[i].push_back(static_cast<int>(std::get<2>(ans).size()));
+          } else if (qt == 1) {
+            size_stats[i].push_back(static_cast<int>(T.ball_count(c, rad)));
+          } else if (qt == 2) {
+            size_stats[i].push_back(static_cast<int>(T.box_report(q).size()));
+          } else {
+            size_stats[i].push_back(static_cast<int>(T.box_count(q)));
+          }
         }
         cnt++;
         total++;
@@ -155,13 +177,17 @@ void RANGE(parlay::sequence<vtx*> &v, double rad, int p, double trial_time, int
             << num_ops / (duration * 1e6) << std::endl << std::endl;
 
     parlay::sequence<int> s = parlay::flatten(visited_stats);
-    size_t i = parlay::max_element(s) - s.begin();
-    size_t sum = parlay::reduce(s);
-    std::cout << "max internal = " << s[i] << ", average internal = " << sum/((double) s.size()) << std::endl;
+    if (s.size() > 0) {
+      size_t i = parlay::max_element(s) - s.begin();
+      size_t sum = parlay::reduce(s);
+      std::cout << "max internal = " << s[i] << ", average internal = " << sum/((double) s.size()) << std::endl;
+    }
     parlay::sequence<int> sizes = parlay::flatten(size_stats);
-    size_t j = parlay::max_element(sizes) - sizes.begin();
-    size_t sum_size = parlay::reduce(sizes);
-    std::cout << "max results = " << sizes[j] << ", average results = " << sum_size/((double) sizes.size()) << std::endl;
+    if (sizes.size() > 0) {
+      size_t j = parlay::max_element(sizes) - sizes.begin();
+      size_t sum_size = parlay::reduce(sizes);
+      std::cout << "max results = " << sizes[j] << ", average results = " << sum_size/((double) sizes.size()) << std::endl;
+    }
     std::cout << "failed ins: " << parlay::reduce(ins_fails) << std::endl;
     std::cout << "failed del: " << parlay::reduce(del_fails) << std::endl;
     std::cout << "total ops: " << num_ops << endl;
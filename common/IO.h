@@ -31,6 +31,8 @@
 #include "../parlay/parallel.h"
 #include "../parlay/io.h"
 #include "../parlay/internal/get_time.h"
+#include "parseText.h"
+#include "binaryIO.h"
 
 namespace benchIO {
   using namespace std;
@@ -201,6 +203,8 @@ namespace benchIO {
 
   template <class T>
   int writeIntSeqToFile(parlay::sequence<T> const &A, char const *fileName) {
+    if (binaryFileName(fileName))
+      return writeBinarySequence(intHeaderIO, A, fileName);
     return writeSeqToFile(intHeaderIO, A, fileName);
   }
 
@@ -216,16 +220,15 @@ namespace benchIO {
 
   template <class T>
   parlay::sequence<T> readIntSeqFromFile(char const *fileName) {
-    auto W = get_tokens(fileName);
-    string header(W[0].begin(),W[0].end());
-    if (header != intHeaderIO) {
+    if (isBinaryFile(fileName))
+      return readBinarySequence<T>(intHeaderIO, fileName);
+    auto S = parlay::file_map(fileName);
+    textTokens W(S);
+    if (W.word(0) != intHeaderIO) {
       cout << "readIntSeqFromFile: bad input" << endl;
       abort();
     }
-    long n = W.size()-1;
-    auto A = parlay::tabulate(n, [&] (long i) -> T {
-	return parlay::chars_to_long(W[i+1]);});
-    return A;
+    return W.parse<T>(1, W.size());
   }
 };
 
@@ -0,0 +1,299 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef PBBS_BINARYIO_H_
+#define PBBS_BINARYIO_H_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "../parlay/primitives.h"
+#include "../parlay/io.h"
+
+// A binary container for the sequence and geometry formats.  The
+// header gives the kind of file (the same string as the header of the
+// text format, e.g. "sequenceInt" or "pbbs_sequencePoint2d"), the byte
+// order, and a list of columns, each with a scalar type, a count and
+// an offset.  Elements are stored one field per column: pairs as two
+// columns, points as one column per coordinate, triangles as the point
+// columns followed by one column per corner, and strings as n+1
+// offsets followed by the characters.  Columns start on 64 byte
+// boundaries so they can be read in place from a mapped file.
+//
+// Binary files are recognized by their first 8 bytes, so the readers
+// in IO.h, sequenceIO.h and geometryIO.h take either format.  The
+// writers use it when the file name ends in ".bin".
+
+namespace benchIO {
+  using namespace std;
+
+  enum scalarType : uint32_t {int32S, uint32S, int64S, uint64S, floatS, doubleS, charS};
+
+  template <class T>
+  constexpr scalarType scalarTypeOf() {
+    if constexpr (std::is_same<T, float>::value) return floatS;
+    else if constexpr (std::is_same<T, double>::value) return doubleS;
+    else if constexpr (sizeof(T) == 1) return charS;
+    else if constexpr (sizeof(T) == 4) return std::is_signed<T>::value ? int32S : uint32S;
+    else return std::is_signed<T>::value ? int64S : uint64S;
+  }
+
+  inline size_t scalarSize(uint32_t t) {
+    switch (t) {
+    case int32S: case uint32S: case floatS: return 4;
+    case int64S: case uint64S: case doubleS: return 8;
+    default: return 1;
+    }
+  }
+
+  constexpr char binaryMagic[8] = {'P','B','B','S','B','I','N','1'};
+  constexpr uint32_t binaryByteOrder = 0x01020304;
+  constexpr int binaryMaxColumns = 16;
+
+  struct binaryColumn {
+    uint32_t type;    // a scalarType
+    uint32_t unused;
+    uint64_t count;
+    uint64_t offset;  // from the start of the file
+  };
+
+  struct binaryHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t num_columns;
+    char kind[48];
+    binaryColumn columns[binaryMaxColumns];
+  };
+
+  inline bool isBinaryFile(char const *fileName) {
+    ifstream file(fileName, ios::in | ios::binary);
+    char m[8];
+    return file.read(m, 8) && memcmp(m, binaryMagic, 8) == 0;
+  }
+
+  inline bool binaryFileName(char const *fileName) {
+    size_t l = strlen(fileName);
+    return l >= 4 && strcmp(fileName + l - 4, ".bin") == 0;
+  }
+
+  // Writes the columns as they are added and the header when closed.
+  struct binaryWriter {
+    ofstream file;
+    binaryHeader H;
+    uint64_t pos;
+
+    binaryWriter(char const *fileName, string const &kind)
+      : file(fileName, ios::out | ios::binary), pos(sizeof(binaryHeader)) {
+      if (!file.is_open()) {
+	cout << "Unable to open file: " << fileName << endl;
+	abort();
+      }
+      memset(&H, 0, sizeof(H));
+      memcpy(H.magic, binaryMagic, 8);
+      H.byte_order = binaryByteOrder;
+      if (kind.size() >= sizeof(H.kind)) {
+	cout << "binaryWriter: kind too long: " << kind << endl;
+	abort();
+      }
+      strcpy(H.kind, kind.c_str());
+      file.write((char*) &H, sizeof(H));
+    }
+
+    // adds a column of n values of type T, the i-th being f(i)
+    template <class T, class F>
+    void column(size_t n, F f) {
+      if (H.num_columns == binaryMaxColumns) {
+	cout << "binaryWriter: too many columns" << endl;
+	abort();
+      }
+      uint64_t start = (pos + 63) / 64 * 64;
+      char zeros[64] = {};
+      file.write(zeros, start - pos);
+      auto A = parlay::tabulate(n, [&] (size_t i) -> T {return (T) f(i);});
+      file.write((char*) A.begin(), n * sizeof(T));
+      H.columns[H.num_columns++] = binaryColumn{scalarTypeOf<T>(), 0, n, start};
+      pos = start + n * sizeof(T);
+    }
+
+    int close() {
+      file.seekp(0);
+      file.write((char*) &H, sizeof(H));
+      file.close();
+      return 0;
+    }
+  };
+
+  // Maps the file and reads columns from it, converting each value to
+  // the requested type.
+  struct binaryReader {
+    parlay::file_map F;
+    binaryHeader H;
+    string fileName;
+
+    binaryReader(char const *fileName) : F(fileName), fileName(fileName) {
+      if (F.size() < sizeof(H)) {
+	cout << fileName << ": not a binary file" << endl;
+	abort();
+      }
+      memcpy(&H, F.begin(), sizeof(H));
+      if (memcmp(H.magic, binaryMagic, 8) != 0) {
+	cout << fileName << ": not a binary file" << endl;
+	abort();
+      }
+      if (H.byte_order != binaryByteOrder) {
+	cout << fileName << ": written with the other byte order" << endl;
+	abort();
+      }
+      for (uint32_t c = 0; c < H.num_columns; c++)
+	if (H.columns[c].offset + H.columns[c].count * scalarSize(H.columns[c].type) > F.size()) {
+	  cout << fileName << ": file is truncated" << endl;
+	  abort();
+	}
+    }
+
+    string kind() const {return string(H.kind, strnlen(H.kind, sizeof(H.kind)));}
+    int num_columns() const {return H.num_columns;}
+    size_t size(int c) const {return H.columns[c].count;}
+    const char* data(int c) const {return F.begin() + H.columns[c].offset;}
+
+    // aborts unless the file is of the given kind and number of columns
+    void check(string const &expected, int columns) const {
+      if (kind() != expected) {
+	cout << "bad header: expected " << expected << " got " << kind() << endl;
+	abort();
+      }
+      if (num_columns() != columns) {
+	cout << fileName << ": expected " << columns << " columns, got "
+	     << num_columns() << endl;
+	abort();
+      }
+    }
+
+    template <class T, class S>
+    parlay::sequence<T> convert(int c) const {
+      const S* A = (const S*) data(c);
+      return parlay::tabulate(size(c), [&] (size_t i) -> T {return (T) A[i];});
+    }
+
+    template <class T>
+    parlay::sequence<T> column(int c) const {
+      switch (H.columns[c].type) {
+      case int32S: return convert<T, int32_t>(c);
+      case uint32S: return convert<T, uint32_t>(c);
+      case int64S: return convert<T, int64_t>(c);
+      case uint64S: return convert<T, uint64_t>(c);
+      case floatS: return convert<T, float>(c);
+      case doubleS: return convert<T, double>(c);
+      default: return convert<T, char>(c);
+      }
+    }
+  };
+
+  // The columns for each element type of a sequence: numbers here,
+  // pairs and strings below.
+  template <class T>
+  struct binaryElements {
+    static constexpr int num_columns = 1;
+    static void write(binaryWriter &W, parlay::sequence<T> const &A) {
+      W.column<T>(A.size(), [&] (size_t i) {return A[i];});
+    }
+    static parlay::sequence<T> read(binaryReader const &R) {
+      return R.column<T>(0);
+    }
+  };
+
+  template <class A, class B>
+  struct binaryElements<pair<A,B>> {
+    static constexpr int num_columns = 2;
+    static void write(binaryWriter &W, parlay::sequence<pair<A,B>> const &S) {
+      W.column<A>(S.size(), [&] (size_t i) {return S[i].first;});
+      W.column<B>(S.size(), [&] (size_t i) {return S[i].second;});
+    }
+    static parlay::sequence<pair<A,B>> read(binaryReader const &R) {
+      auto first = R.column<A>(0);
+      auto second = R.column<B>(1);
+      if (first.size() != second.size()) {
+	cout << R.fileName << ": columns of different lengths" << endl;
+	abort();
+      }
+      return parlay::tabulate(first.size(), [&] (size_t i) {
+	  return std::make_pair(first[i], second[i]);});
+    }
+  };
+
+  template <>
+  struct binaryElements<parlay::sequence<char>> {
+    static constexpr int num_columns = 2;
+    static void write(binaryWriter &W, parlay::sequence<parlay::sequence<char>> const &S) {
+      auto [offsets, total] = parlay::scan(parlay::map(S, [] (auto const &s) {
+	    return (uint64_t) s.size();}));
+      W.column<uint64_t>(S.size() + 1, [&] (size_t i) {
+	  return (i == S.size()) ? total : offsets[i];});
+      auto chars = parlay::flatten(S);
+      W.column<char>(total, [&] (size_t i) {return chars[i];});
+    }
+    static parlay::sequence<parlay::sequence<char>> read(binaryReader const &R) {
+      auto offsets = R.column<uint64_t>(0);
+      const char* chars = R.data(1);
+      if (offsets.size() == 0 || offsets[offsets.size() - 1] != R.size(1)) {
+	cout << R.fileName << ": string offsets do not match the characters" << endl;
+	abort();
+      }
+      return parlay::tabulate(offsets.size() - 1, [&] (size_t i) {
+	  return parlay::to_sequence(parlay::make_slice(chars + offsets[i],
+							chars + offsets[i + 1]));});
+    }
+  };
+
+  template <class T>
+  int writeBinarySequence(string const &kind, parlay::sequence<T> const &A,
+			  char const *fileName) {
+    binaryWriter W(fileName, kind);
+    binaryElements<T>::write(W, A);
+    return W.close();
+  }
+
+  template <class T>
+  parlay::sequence<T> readBinarySequence(string const &kind, char const *fileName) {
+    binaryReader R(fileName);
+    R.check(kind, binaryElements<T>::num_columns);
+    return binaryElements<T>::read(R);
+  }
+
+  // the header of a text file, or the kind of a binary one
+  inline string fileKind(char const *fileName) {
+    if (isBinaryFile(fileName)) return binaryReader(fileName).kind();
+    ifstream file(fileName, ios::in);
+    if (!file.is_open()) {
+      cout << "Unable to open file: " << fileName << endl;
+      abort();
+    }
+    string header;
+    file >> header;
+    return header;
+  }
+};
+
+#endif
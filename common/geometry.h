@@ -6,6 +6,7 @@
 #include <iomanip>
 #include "../parlay/parallel.h"
 #include "../parlay/primitives.h"
+#include "predicates.h"
 using namespace std;
 
 // *************************************************************
@@ -200,6 +201,155 @@ using namespace std;
   static std::ostream& operator<<(std::ostream& os, const point2d<coord> v) {
     return os << v.x << " " << v.y; }
 
+  // *************************************************************
+  //    ROBUST PREDICATES
+  // *************************************************************
+
+  // The signs of these are exact; see predicates.h.  The magnitudes
+  // are accurate to within the rounding error of a double evaluation.
+
+  // Positive if a, b and c are in counterclockwise order, negative if
+  // clockwise, and zero if they are collinear.  Equals twice the
+  // signed area of the triangle.
+  template <class coord>
+  inline double orient2d(point2d<coord> a, point2d<coord> b, point2d<coord> c) {
+    double detleft = (a.x - c.x) * (b.y - c.y);
+    double detright = (a.y - c.y) * (b.x - c.x);
+    double det = detleft - detright;
+    double permanent = std::abs(detleft) + std::abs(detright);
+    if (std::abs(det) > predicates::o2d_bound * permanent) return det;
+    double pa[2] = {(double) a.x, (double) a.y};
+    double pb[2] = {(double) b.x, (double) b.y};
+    double pc[2] = {(double) c.x, (double) c.y};
+    return predicates::orient2d_exact(pa, pb, pc);
+  }
+
+  // A static filter for orient2d: a bound on the rounding error of
+  // its double evaluation for points whose coordinates are at most
+  // max_abs in absolute value.  Computed once for a point set, it lets
+  // most tests be settled with a single comparison.
+  inline double orient2d_static_bound(double max_abs) {
+    double eps = predicates::epsilon;
+    return predicates::o2d_bound * 8.0 * max_abs * max_abs * (1.0 + 32.0 * eps);
+  }
+
+  template <class coord>
+  inline double orient2d_static_bound(parlay::sequence<point2d<coord>> const &P) {
+    auto abs_max = parlay::delayed_tabulate(P.size(), [&] (size_t i) -> double {
+      return std::max(std::abs((double) P[i].x), std::abs((double) P[i].y));});
+    return orient2d_static_bound(parlay::reduce(abs_max, parlay::maxm<double>()));
+  }
+
+  // orient2d with a static filter from orient2d_static_bound
+  template <class coord>
+  inline double orient2d(point2d<coord> a, point2d<coord> b, point2d<coord> c,
+			 double static_bound) {
+    double detleft = (a.x - c.x) * (b.y - c.y);
+    double detright = (a.y - c.y) * (b.x - c.x);
+    double det = detleft - detright;
+    if (std::abs(det) > static_bound) return det;
+    double permanent = std::abs(detleft) + std::abs(detright);
+    if (std::abs(det) > predicates::o2d_bound * permanent) return det;
+    double pa[2] = {(double) a.x, (double) a.y};
+    double pb[2] = {(double) b.x, (double) b.y};
+    double pc[2] = {(double) c.x, (double) c.y};
+    return predicates::orient2d_exact(pa, pb, pc);
+  }
+
+  // Positive if d lies inside the circle through a, b and c, negative
+  // if outside, and zero if on it.  The points a, b and c must be in
+  // counterclockwise order, or the sign is reversed.
+  template <class coord>
+  inline double incircle(point2d<coord> a, point2d<coord> b,
+			 point2d<coord> c, point2d<coord> d) {
+    double adx = a.x - d.x, bdx = b.x - d.x, cdx = c.x - d.x;
+    double ady = a.y - d.y, bdy = b.y - d.y, cdy = c.y - d.y;
+    double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    double cdxady = cdx * ady, adxcdy = adx * cdy;
+    double adxbdy = adx * bdy, bdxady = bdx * ady;
+    double alift = adx * adx + ady * ady;
+    double blift = bdx * bdx + bdy * bdy;
+    double clift = cdx * cdx + cdy * cdy;
+    double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy)
+      + clift * (adxbdy - bdxady);
+    double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift
+      + (std::abs(cdxady) + std::abs(adxcdy)) * blift
+      + (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+    if (std::abs(det) > predicates::icc_bound * permanent) return det;
+    double pa[2] = {(double) a.x, (double) a.y};
+    double pb[2] = {(double) b.x, (double) b.y};
+    double pc[2] = {(double) c.x, (double) c.y};
+    double pd[2] = {(double) d.x, (double) d.y};
+    return predicates::incircle_exact(pa, pb, pc, pd);
+  }
+
+  // Positive if d lies below the plane through a, b and c, where
+  // below means that a, b, c appear counterclockwise from above,
+  // negative if above, and zero if the four points are coplanar.
+  template <class coord>
+  inline double orient3d(point3d<coord> a, point3d<coord> b,
+  		       point3d<coord> c, point3d<coord> d) {
+    double adx = a.x - d.x, bdx = b.x - d.x, cdx = c.x - d.x;
+    double ady = a.y - d.y, bdy = b.y - d.y, cdy = c.y - d.y;
+    double adz = a.z - d.z, bdz = b.z - d.z, cdz = c.z - d.z;
+    double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+    double cdxady = cdx * ady, adxcdy = adx * cdy;
+    double adxbdy = adx * bdy, bdxady = bdx * ady;
+    double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+    double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(adz)
+      + (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bdz)
+      + (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cdz);
+    if (std::abs(det) > predicates::o3d_bound * permanent) return det;
+    double pa[3] = {(double) a.x, (double) a.y, (double) a.z};
+    double pb[3] = {(double) b.x, (double) b.y, (double) b.z};
+    double pc[3] = {(double) c.x, (double) c.y, (double) c.z};
+    double pd[3] = {(double) d.x, (double) d.y, (double) d.z};
+    return predicates::orient3d_exact(pa, pb, pc, pd);
+  }
+
+  // Positive if e lies inside the sphere through a, b, c and d,
+  // negative if outside, and zero if on it.  The points a, b, c, d
+  // must be ordered so that orient3d(a, b, c, d) is positive, or the
+  // sign is reversed.
+  template <class coord>
+  inline double insphere(point3d<coord> a, point3d<coord> b, point3d<coord> c,
+  		       point3d<coord> d, point3d<coord> e) {
+    double x[4], y[4], z[4], lift[4], alift[4];
+    point3d<coord> p[4] = {a, b, c, d};
+    for (int i = 0; i < 4; i++) {
+      x[i] = p[i].x - e.x; y[i] = p[i].y - e.y; z[i] = p[i].z - e.z;
+      lift[i] = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+      alift[i] = lift[i];
+    }
+    // the minors, and the same with every term replaced by its
+    // absolute value, which bounds the rounding error
+    auto minor = [&] (int i, int j, double& m, double& pm) {
+      double l = x[i] * y[j], r = x[j] * y[i];
+      m = l - r;
+      pm = std::abs(l) + std::abs(r);
+    };
+    double ab, bc, cd, da, ac, bd, pab, pbc, pcd, pda, pac, pbd;
+    minor(0, 1, ab, pab); minor(1, 2, bc, pbc); minor(2, 3, cd, pcd);
+    minor(3, 0, da, pda); minor(0, 2, ac, pac); minor(1, 3, bd, pbd);
+    double az = std::abs(z[0]), bz = std::abs(z[1]), cz = std::abs(z[2]), dz = std::abs(z[3]);
+    double abc = z[0] * bc - z[1] * ac + z[2] * ab;
+    double bcd = z[1] * cd - z[2] * bd + z[3] * bc;
+    double cda = z[2] * da + z[3] * ac + z[0] * cd;
+    double dab = z[3] * ab + z[0] * bd + z[1] * da;
+    double det = (lift[3] * abc - lift[2] * dab) + (lift[1] * cda - lift[0] * bcd);
+    double permanent = ((az * pbc + bz * pac + cz * pab) * alift[3]
+  		      + (dz * pab + az * pbd + bz * pda) * alift[2])
+      + ((cz * pda + dz * pac + az * pcd) * alift[1]
+         + (bz * pcd + cz * pbd + dz * pbc) * alift[0]);
+    if (std::abs(det) > predicates::isp_bound * permanent) return det;
+    double q[5][3];
+    point3d<coord> all[5] = {a, b, c, d, e};
+    for (int i = 0; i < 5; i++) {
+      q[i][0] = all[i].x; q[i][1] = all[i].y; q[i][2] = all[i].z;
+    }
+    return predicates::insphere_exact(q[0], q[1], q[2], q[3], q[4]);
+  }
+
   // *************************************************************
   //    GEOMETRY
   // *************************************************************
@@ -207,7 +357,7 @@ using namespace std;
   // Returns twice the area of the oriented triangle (a, b, c)
   template <class coord>
   inline coord triArea(point2d<coord> a, point2d<coord> b, point2d<coord> c) {
-    return (b-a).cross(c-a);
+    return orient2d(a, b, c);
   }
 
   template <class coord>
@@ -218,7 +368,7 @@ using namespace std;
   // Returns TRUE if the points a, b, c are in a counterclockise order
   template <class coord>
   inline bool counterClockwise(point2d<coord> a, point2d<coord> b, point2d<coord> c) {
-    return (b-a).cross(c-a) > 0.0;
+    return orient2d(a, b, c) > 0.0;
   }
 
   template <class coord>
@@ -226,16 +376,11 @@ using namespace std;
     return vector3d<coord>(v.x, v.y, v.x*v.x + v.y*v.y);}
 
   // Returns TRUE if the point d is inside the circle defined by the
-  // points a, b, c. 
-  // Projects a, b, c onto a parabola centered with d at the origin
-  //   and does a plane side test (tet volume > 0 test)
+  // points a, b, c (in counterclockwise order)
   template <class coord>
   inline bool inCircle(point2d<coord> a, point2d<coord> b, 
 		       point2d<coord> c, point2d<coord> d) {
-    vector3d<coord> ad = onParabola(a-d);
-    vector3d<coord> bd = onParabola(b-d);
-    vector3d<coord> cd = onParabola(c-d);
-    return (ad.cross(bd)).dot(cd) > 0.0;
+    return incircle(a, b, c, d) > 0.0;
   }
 
   // returns a number between -1 and 1, such that -1 is out at infinity,
@@ -266,6 +411,23 @@ using namespace std;
       : P(std::move(P)), T(std::move(T)) {}
   };
 
+  // *************************************************************
+  //    TETRAHEDRA
+  // *************************************************************
+
+  using tet = std::array<int,4>;
+
+  template <class point>
+  struct tetrahedra {
+    size_t numPoints() {return P.size();};
+    size_t numTetrahedra() {return T.size();}
+    parlay::sequence<point> P;
+    parlay::sequence<tet> T;
+    tetrahedra() {}
+    tetrahedra(parlay::sequence<point> P, parlay::sequence<tet> T)
+      : P(std::move(P)), T(std::move(T)) {}
+  };
+
   template <class point>
   struct ray {
     using vector = typename point::vector;
@@ -79,21 +79,78 @@ namespace benchIO {
   string HeaderPoint2d = "pbbs_sequencePoint2d";
   string HeaderPoint3d = "pbbs_sequencePoint3d";
   string HeaderTriangles = "pbbs_triangles";
+  string HeaderTetrahedra = "pbbs_tetrahedra";
+  string HeaderFacets = "pbbs_facets";
+
+  // In binary files points are stored as one column per coordinate,
+  // and triangles, tetrahedra and facets as one column per corner.
+  template <class Point>
+  void writePointColumns(binaryWriter &W, parlay::sequence<Point> const &P) {
+    using coord = typename Point::coord;
+    W.column<coord>(P.size(), [&] (size_t i) {return P[i].x;});
+    W.column<coord>(P.size(), [&] (size_t i) {return P[i].y;});
+    if constexpr (Point::dim == 3)
+      W.column<coord>(P.size(), [&] (size_t i) {return P[i].z;});
+  }
+
+  // the points in columns [c, c + dim)
+  template <class Point>
+  parlay::sequence<Point> readPointColumns(binaryReader const &R, int c) {
+    using coord = typename Point::coord;
+    int d = Point::dim;
+    auto C = parlay::tabulate(d, [&] (size_t j) {return R.column<coord>(c + j);}, 1);
+    size_t n = C[0].size();
+    for (int j = 1; j < d; j++)
+      if (C[j].size() != n) {
+	cout << R.fileName << ": coordinates of different lengths" << endl;
+	abort();
+      }
+    return parlay::tabulate(n, [&] (size_t i) -> Point {
+	coord a[3];
+	for (int j = 0; j < d; j++) a[j] = C[j][i];
+	return Point(parlay::make_slice(a, a + d));});
+  }
+
+  template <class Corners>
+  void writeCornerColumns(binaryWriter &W, parlay::sequence<Corners> const &T) {
+    for (size_t j = 0; j < std::tuple_size<Corners>::value; j++)
+      W.column<int>(T.size(), [&] (size_t i) {return T[i][j];});
+  }
+
+  template <class Corners>
+  parlay::sequence<Corners> readCornerColumns(binaryReader const &R, int c, int offset) {
+    int k = std::tuple_size<Corners>::value;
+    auto C = parlay::tabulate(k, [&] (size_t j) {return R.column<int>(c + j);}, 1);
+    size_t m = C[0].size();
+    for (int j = 1; j < k; j++)
+      if (C[j].size() != m) {
+	cout << R.fileName << ": corners of different lengths" << endl;
+	abort();
+      }
+    return parlay::tabulate(m, [&] (size_t i) -> Corners {
+	Corners t;
+	for (int j = 0; j < k; j++) t[j] = C[j][i] - offset;
+	return t;});
+  }
 
   template <class Point>
     int writePointsToFile(parlay::sequence<Point> const &P, char const *fname) {
     string Header = (Point::dim == 2) ? HeaderPoint2d : HeaderPoint3d;
+    if (binaryFileName(fname)) {
+      binaryWriter W(fname, Header);
+      writePointColumns(W, P);
+      return W.close();
+    }
     int r = writeSeqToFile(Header, P, fname);
     return r;
   }
 
-  template <class Point, class Seq>
-  parlay::sequence<Point> parsePoints(Seq W) {
+  // n points starting at token start
+  template <class Point>
+  parlay::sequence<Point> parsePoints(textTokens const &W, size_t start, size_t n) {
     using coord = typename Point::coord;
     int d = Point::dim;
-    size_t n = W.size()/d;
-    auto a = parlay::tabulate(d * n, [&] (size_t i) -> coord {
-	return atof(W[i]);});
+    auto a = W.parse<coord>(start, start + d * n);
     auto points = parlay::tabulate(n, [&] (size_t i) -> Point {
 	return Point(a.cut(d*i,d*(i + 1)));});
     return points;
@@ -101,14 +158,19 @@ namespace benchIO {
 
   template <class Point>
   parlay::sequence<Point> readPointsFromFile(char const *fname) {
-    parlay::sequence<char> S = readStringFromFile(fname);
-    parlay::sequence<char*> W = stringToWords(S);
     int d = Point::dim;
-    if (W.size() == 0 || W[0] != (d == 2 ? HeaderPoint2d : HeaderPoint3d)) {
+    if (isBinaryFile(fname)) {
+      binaryReader R(fname);
+      R.check(d == 2 ? HeaderPoint2d : HeaderPoint3d, d);
+      return readPointColumns<Point>(R, 0);
+    }
+    auto S = parlay::file_map(fname);
+    textTokens W(S);
+    if (W.size() == 0 || W.word(0) != (d == 2 ? HeaderPoint2d : HeaderPoint3d)) {
       cout << "readPointsFromFile wrong file type" << endl;
       abort();
     }
-    return parsePoints<Point>(W.cut(1,W.size()));
+    return parsePoints<Point>(W, 1, (W.size()-1)/d);
   }
 
   // triangles<point2d> readTrianglesFromFileNodeEle(char const *fname) {
@@ -146,33 +208,41 @@ namespace benchIO {
   template <class pointT>
   triangles<pointT> readTrianglesFromFile(char const *fname, int offset) {
     int d = pointT::dim;
-    parlay::sequence<char> S = readStringFromFile(fname);
-    parlay::sequence<char*> W = stringToWords(S);
-    if (W[0] != HeaderTriangles) {
+    if (isBinaryFile(fname)) {
+      binaryReader R(fname);
+      R.check(HeaderTriangles, d + 3);
+      return triangles<pointT>(readPointColumns<pointT>(R, 0),
+			       readCornerColumns<tri>(R, d, offset));
+    }
+    auto S = parlay::file_map(fname);
+    textTokens W(S);
+    if (W.word(0) != HeaderTriangles) {
       cout << "readTrianglesFromFile wrong file type" << endl;
       abort();
     }
 
     int headerSize = 3;
-    size_t n = atol(W[1]);
-    size_t m = atol(W[2]);
+    size_t n = W.get<long>(1);
+    size_t m = W.get<long>(2);
     if (W.size() != headerSize + 3 * m + d * n) {
       cout << "readTrianglesFromFile inconsistent length" << endl;
       abort();
     }
 
-    auto pts_slice = W.cut(headerSize, headerSize + d * n);
-    auto tri_slice = W.cut(headerSize + d * n, W.size());
-    parlay::sequence<pointT> Pts = parsePoints<pointT>(pts_slice);
-    auto Tri = parlay::tabulate(m, [&] (size_t i ) -> tri {
-				     return {(int) atol(tri_slice[3*i])-offset,
-					     (int) atol(tri_slice[3*i+1])-offset,
-					     (int) atol(tri_slice[3*i+2])-offset};});
+    parlay::sequence<pointT> Pts = parsePoints<pointT>(W, headerSize, n);
+    auto Tri = W.parse_fields<tri>(headerSize + d * n, m, 3, [&] (tri &t, int r, const char* p) {
+	t[r] = (int) parse_long(p, W.end()) - offset;});
     return triangles<pointT>(Pts,Tri);
   }
 
   template <class pointT>
   int writeTrianglesToFile(triangles<pointT> Tr, char* fileName) {
+    if (binaryFileName(fileName)) {
+      binaryWriter W(fileName, HeaderTriangles);
+      writePointColumns(W, Tr.P);
+      writeCornerColumns(W, Tr.T);
+      return W.close();
+    }
     ofstream file (fileName, ios::binary);
     if (!file.is_open()) {
       std::cout << "Unable to open file: " << fileName << std::endl;
@@ -190,5 +260,105 @@ namespace benchIO {
     return 0;
   }
 
+  template <class pointT>
+  tetrahedra<pointT> readTetrahedraFromFile(char const *fname, int offset) {
+    int d = pointT::dim;
+    if (isBinaryFile(fname)) {
+      binaryReader R(fname);
+      R.check(HeaderTetrahedra, d + 4);
+      return tetrahedra<pointT>(readPointColumns<pointT>(R, 0),
+				readCornerColumns<tet>(R, d, offset));
+    }
+    auto S = parlay::file_map(fname);
+    textTokens W(S);
+    if (W.size() == 0 || W.word(0) != HeaderTetrahedra) {
+      cout << "readTetrahedraFromFile wrong file type" << endl;
+      abort();
+    }
+
+    int headerSize = 3;
+    size_t n = W.get<long>(1);
+    size_t m = W.get<long>(2);
+    if (W.size() != headerSize + 4 * m + d * n) {
+      cout << "readTetrahedraFromFile inconsistent length" << endl;
+      abort();
+    }
+
+    parlay::sequence<pointT> Pts = parsePoints<pointT>(W, headerSize, n);
+    auto Tet = W.parse_fields<tet>(headerSize + d * n, m, 4, [&] (tet &t, int r, const char* p) {
+	t[r] = (int) parse_long(p, W.end()) - offset;});
+    return tetrahedra<pointT>(Pts,Tet);
+  }
+
+  template <class pointT>
+  int writeTetrahedraToFile(tetrahedra<pointT> Tr, char* fileName) {
+    if (binaryFileName(fileName)) {
+      binaryWriter W(fileName, HeaderTetrahedra);
+      writePointColumns(W, Tr.P);
+      writeCornerColumns(W, Tr.T);
+      return W.close();
+    }
+    ofstream file (fileName, ios::binary);
+    if (!file.is_open()) {
+      std::cout << "Unable to open file: " << fileName << std::endl;
+      return 1;
+    }
+    file << HeaderTetrahedra << endl;
+    file << Tr.numPoints() << endl;
+    file << Tr.numTetrahedra() << endl;
+    writeSeqToStream(file, Tr.P);
+    auto A = parlay::tabulate(4*Tr.numTetrahedra(), [&] (size_t i) -> int {
+						     return (Tr.T[i/4])[i%4];});
+    writeSeqToStream(file, A);
+    file.close();
+    return 0;
+  }
+
+  // A list of triangular facets given as indices into a separate
+  // point file (e.g. a 3d convex hull)
+  inline parlay::sequence<tri> readFacetsFromFile(char const *fname) {
+    if (isBinaryFile(fname)) {
+      binaryReader R(fname);
+      R.check(HeaderFacets, 3);
+      return readCornerColumns<tri>(R, 0, 0);
+    }
+    auto S = parlay::file_map(fname);
+    textTokens W(S);
+    if (W.size() == 0 || W.word(0) != HeaderFacets) {
+      cout << "readFacetsFromFile wrong file type" << endl;
+      abort();
+    }
+
+    int headerSize = 2;
+    size_t m = W.get<long>(1);
+    if (W.size() != headerSize + 3 * m) {
+      cout << "readFacetsFromFile inconsistent length" << endl;
+      abort();
+    }
+
+    return W.parse_fields<tri>(headerSize, m, 3, [&] (tri &t, int r, const char* p) {
+	t[r] = (int) parse_long(p, W.end());});
+  }
+
+  inline int writeFacetsToFile(parlay::sequence<tri> const &F, char* fileName) {
+    if (binaryFileName(fileName)) {
+      binaryWriter W(fileName, HeaderFacets);
+      writeCornerColumns(W, F);
+      return W.close();
+    }
+    ofstream file (fileName, ios::binary);
+    if (!file.is_open()) {
+      std::cout << "Unable to open file: " << fileName << std::endl;
+      return 1;
+    }
+    file << HeaderFacets << endl;
+    file << F.size() << endl;
+    auto A = parlay::tabulate(3*F.size(), [&] (size_t i) -> int {
+	return F[i/3][i%3];});
+    writeSeqToStream(file, A);
+    file.close();
+    return 0;
+  }
+
 };
 #endif
@@ -6,6 +6,9 @@
 #include <iomanip>
 #include <iostream>
 #include <string>
+#ifdef PERF_COUNTERS
+#include "perf_counters.h"
+#endif
 
 struct timer {
   double total_time;
@@ -13,6 +16,9 @@ struct timer {
   bool on;
   std::string name;
   struct timezone tzp;
+#ifdef PERF_COUNTERS
+  pbbs::perf::counts last_counts;
+#endif
 
   timer(std::string name = "PBBS time", bool _start = true)
   : total_time(0.0), on(false), name(name), tzp({0,0}) {
@@ -28,6 +34,9 @@ struct timer {
   void start () {
     on = 1;
     last_time = get_time();
+#ifdef PERF_COUNTERS
+    last_counts = pbbs::perf::read();
+#endif
   }
 
   double stop () {
@@ -77,7 +86,12 @@ struct timer {
   }
 
   void next(std::string str) {
-    if (on) report(get_next(), str);
+    if (!on) return;
+    double d = get_next();
+#ifdef PERF_COUNTERS
+    last_counts = pbbs::perf::phase(name, str, d, last_counts);
+#endif
+    report(d, str);
   }
 };
 
@@ -0,0 +1,314 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef PBBS_GRAPHGENERATORS_H_
+#define PBBS_GRAPHGENERATORS_H_
+
+#include <iostream>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <math.h>
+#include "graph.h"
+#include "graphUtils.h"
+#include "dataGen.h"
+#include "../parlay/parallel.h"
+#include "../parlay/primitives.h"
+
+// Graph generators, used both by the programs in testData/graphData,
+// which write the graphs to files, and by the benchmark drivers, which
+// can build their input in memory from a spec such as
+//   rMat:n=2^24,m=12*2^24,a=.55,b=.125,o=1
+// The graph built from a spec is identical to the one read back from
+// the file written by the corresponding generator with -j and the same
+// options.
+
+namespace dataGen {
+
+  // **************************************************************
+  //    RMAT
+  // **************************************************************
+
+  template <class intV>
+  struct rMat {
+    using edgeT = edge<intV>;
+    double a, ab, abc;
+    size_t n; 
+    size_t h;
+    rMat(size_t _n, size_t _seed, 
+	 double _a, double _b, double _c) {
+      n = _n; a = _a; ab = _a + _b; abc = _a+_b+_c;
+      h = dataGen::hash<size_t>(_seed);
+      if (!(abc <= 1.0)) {
+	std::cout << "in rMat: a + b + c add to more than 1" << std::endl;
+	abort();
+      }
+      if (!((1 << parlay::log2_up(n)) == n)) {
+	std::cout << "in rMat: n not a power of 2" << std::endl;
+	abort();
+      }		 
+    }
+
+    edgeT rMatRec(size_t nn, size_t randStart, size_t randStride) {
+      if (nn==1) return edgeT(0,0);
+      else {
+	edgeT x = rMatRec(nn/2, randStart + randStride, randStride);
+	double r = dataGen::hash<double>(randStart);
+	if (r < a) return x;
+	else if (r < ab) return edgeT(x.u,x.v+nn/2);
+	else if (r < abc) return edgeT(x.u+nn/2, x.v);
+	else return edgeT(x.u+nn/2, x.v+nn/2);
+      }
+    }
+
+    edge<intV> operator() (size_t i) {
+      size_t randStart = dataGen::hash<size_t>((2*i)*h);
+      size_t randStride = dataGen::hash<size_t>((2*i+1)*h);
+      return rMatRec(n, randStart, randStride);
+    }
+  };
+
+  template <class intV>
+  edgeArray<intV> edgeRmat(size_t n, size_t m, size_t seed, 
+			   double a, double b, double c) {
+    size_t nn = (1 << parlay::log2_up(n));
+    rMat<intV> g(nn,seed,a,b,c);
+    auto E = parlay::tabulate(m, [&] (size_t i) -> edge<intV> {return g(i);});
+    return edgeArray<intV>(std::move(E), nn, nn);
+  }
+
+  // **************************************************************
+  //    RANDOM LOCAL GRAPH
+  // **************************************************************
+
+  // Generates an undirected graph with n vertices with approximately degree 
+  // neighbors per vertex.
+  // Edges  are distributed so they appear to come from
+  // a dim-dimensional space.   In particular an edge (i,j) will have
+  // probability roughly proportional to (1/|i-j|)^{(d+1)/d}, giving 
+  // separators of size about n^{(d-1)/d}.    
+  template <class intV>
+  edgeArray<intV> edgeRandomWithDimension(size_t dim, size_t degree, size_t numRows) {
+    size_t nonZeros = numRows*degree;
+    auto E = parlay::tabulate(nonZeros, [&] (size_t k) -> edge<intV> {
+	size_t i = k / degree;
+	size_t j;
+	if (dim==0) {
+	  size_t h = k;
+	  do {
+	    j = ((h = dataGen::hash<intV>(h)) % numRows);
+	  } while (j == i);
+	} else {
+	  size_t pow = dim+2;
+	  size_t h = k;
+	  do {
+	    while ((((h = dataGen::hash<intV>(h)) % 1000003) < 500001)) pow += dim;
+	    j = (i + ((h = dataGen::hash<intV>(h)) % (((long) 1) << pow))) % numRows;
+	  } while (j == i);
+	}
+	return edge<intV>(i, j);
+      });
+    return edgeArray<intV>(std::move(E), numRows, numRows);
+  }
+
+  // **************************************************************
+  //    GRIDS
+  // **************************************************************
+
+  inline size_t loc2d(size_t n, size_t i1, size_t i2) {
+    return ((i1 + n) % n)*n + (i2 + n) % n;
+  }
+
+  template <class intV>
+  edgeArray<intV> edge2DMesh(size_t n) {
+    size_t dn = round(pow((float) n,1.0/2.0));
+    size_t nn = dn*dn;
+    size_t nonZeros = 2*nn;
+    parlay::sequence<edge<intV>> E(nonZeros);
+    parlay::parallel_for (0, dn, [&] (size_t i) {
+      for (size_t j=0; j < dn; j++) {
+	size_t l = loc2d(dn,i,j);
+	E[2*l] = edge<intV>(l,loc2d(dn,i+1,j));
+	E[2*l+1] = edge<intV>(l,loc2d(dn,i,j+1));
+      }});
+    return edgeArray<intV>(std::move(E), nn, nn);
+  }
+
+  inline size_t loc3d(size_t n, size_t i1, size_t i2, size_t i3) {
+    return ((i1 + n) % n)*n*n + ((i2 + n) % n)*n + (i3 + n) % n;
+  }
+
+  template <class intV>
+  edgeArray<intV> edge3DMesh(size_t n) {
+    size_t dn = round(pow((float) n,1.0/3.0));
+    size_t nn = dn*dn*dn;
+    size_t nonZeros = 3*nn;
+    parlay::sequence<edge<intV>> E(nonZeros);
+    parlay::parallel_for (0, dn, [&] (size_t i) {
+      for (size_t j=0; j < dn; j++) 
+	for (size_t k=0; k < dn; k++) {
+	  size_t l = loc3d(dn,i,j,k);
+	  E[3*l] =   edge<intV>(l,loc3d(dn,i+1,j,k));
+	  E[3*l+1] = edge<intV>(l,loc3d(dn,i,j+1,k));
+	  E[3*l+2] = edge<intV>(l,loc3d(dn,i,j,k+1));
+	}});
+    return edgeArray<intV>(std::move(E), nn, nn);
+  }
+
+  // **************************************************************
+  //    GENERATOR SPECS
+  // **************************************************************
+
+  // A spec is name:key=value,key=value,...  A value is a number, or a
+  // product of numbers separated by '*', where each can be written as
+  // 2^k or with a K, M or G suffix.  Every key has to be used by the
+  // generator, to catch misspellings.
+  struct genSpec {
+    std::string spec;
+    std::string name;
+    std::map<std::string,std::string> args;
+    mutable std::set<std::string> used;
+
+    [[noreturn]] void error(std::string msg) const {
+      std::cout << "generator spec " << spec << ": " << msg << std::endl;
+      abort();
+    }
+
+    genSpec(std::string s) : spec(s) {
+      size_t c = s.find(':');
+      name = s.substr(0, c);
+      if (c == std::string::npos) return;
+      std::string rest = s.substr(c + 1);
+      while (rest.size() > 0) {
+	size_t e = rest.find(',');
+	std::string arg = rest.substr(0, e);
+	size_t eq = arg.find('=');
+	if (eq == std::string::npos) error("missing = in " + arg);
+	args[arg.substr(0, eq)] = arg.substr(eq + 1);
+	rest = (e == std::string::npos) ? "" : rest.substr(e + 1);
+      }
+    }
+
+    double number(std::string v) const {
+      double r = 1.0;
+      while (v.size() > 0) {
+	size_t e = v.find('*');
+	std::string t = v.substr(0, e);
+	v = (e == std::string::npos) ? "" : v.substr(e + 1);
+	size_t p = t.find('^');
+	char* end;
+	if (p != std::string::npos) {
+	  double base = strtod(t.substr(0, p).c_str(), &end);
+	  if (*end != 0) error("bad number " + t);
+	  double exp = strtod(t.substr(p + 1).c_str(), &end);
+	  if (*end != 0) error("bad number " + t);
+	  r *= pow(base, exp);
+	} else {
+	  double x = strtod(t.c_str(), &end);
+	  std::string suffix(end);
+	  if (suffix == "K") x *= 1e3;
+	  else if (suffix == "M") x *= 1e6;
+	  else if (suffix == "G") x *= 1e9;
+	  else if (suffix != "") error("bad number " + t);
+	  r *= x;
+	}
+      }
+      return r;
+    }
+
+    bool has(std::string key) const {return args.count(key) > 0;}
+
+    double get(std::string key, double dflt) const {
+      used.insert(key);
+      return has(key) ? number(args.at(key)) : dflt;
+    }
+
+    size_t getSize(std::string key, size_t dflt) const {
+      return (size_t) llround(get(key, (double) dflt));
+    }
+
+    size_t required(std::string key) const {
+      if (!has(key)) error("missing " + key);
+      return getSize(key, 0);
+    }
+
+    void checkUsed() const {
+      for (auto const &a : args)
+	if (used.count(a.first) == 0) error("unknown argument " + a.first);
+    }
+  };
+
+  // The generators by name.  Each takes a spec and returns the edges,
+  // with the same arguments and defaults as the generator program.
+  using edgeGenerator = std::function<edgeArray<size_t>(genSpec const&)>;
+
+  inline std::map<std::string, edgeGenerator>& graphGenerators() {
+    static std::map<std::string, edgeGenerator> gens = {
+      // as rMatGraph [-m <m>] [-s <seed>] [-a <a>] [-b <b>] [-c <c>] n
+      {"rMat", [] (genSpec const &S) {
+	  size_t n = S.required("n");
+	  double b = S.get("b", .1);
+	  return edgeRmat<size_t>(n, S.getSize("m", 10*n), S.getSize("seed", 1),
+				  S.get("a", .5), b, S.get("c", b));}},
+      // as randLocalGraph [-m <m>] [-d <dims>] n
+      {"randLocal", [] (genSpec const &S) {
+	  size_t n = S.required("n");
+	  size_t m = S.getSize("m", 10*n);
+	  return edgeRandomWithDimension<size_t>(S.getSize("d", 0), m/n, n);}},
+      // as gridGraph [-d {2,3}] n
+      {"grid", [] (genSpec const &S) {
+	  size_t n = S.required("n");
+	  size_t d = S.getSize("d", 2);
+	  if (d == 2) return edge2DMesh<size_t>(n);
+	  if (d != 3) S.error("d has to be 2 or 3");
+	  return edge3DMesh<size_t>(n);}}
+    };
+    return gens;
+  }
+
+  // Builds the symmetric graph given by the spec, as the generator
+  // program does with -j.  It is randomly relabeled unless o=1 (as
+  // with -o).
+  template <class intV, class intE>
+  graph<intV,intE> generateGraph(std::string spec) {
+    genSpec S(spec);
+    auto &gens = graphGenerators();
+    auto g = gens.find(S.name);
+    if (g == gens.end()) {
+      std::cout << "unknown graph generator " << S.name << ", the generators are:";
+      for (auto const &x : gens) std::cout << " " << x.first;
+      std::cout << std::endl;
+      abort();
+    }
+    bool ordered = S.getSize("o", 0);
+    edgeArray<size_t> EA = g->second(S);
+    S.checkUsed();
+    auto G = graphFromEdges<size_t,size_t>(EA, true);
+    if (!ordered) G = graphReorder(G);
+    return graph<intV,intE>(parlay::map(G.offsets, [] (size_t o) {return (intE) o;}),
+			    parlay::map(G.edges, [] (size_t v) {return (intV) v;}),
+			    G.n);
+  }
+};
+
+#endif
@@ -145,16 +145,15 @@ namespace benchIO {
 
   template <class intV>
   edgeArray<intV> readEdgeArrayFromFile(char* fname) {
-    parlay::sequence<char> S = readStringFromFile(fname);
-    parlay::sequence<char*> W = stringToWords(S);
-    if (W[0] != EdgeArrayHeader) {
+    auto S = parlay::file_map(fname);
+    textTokens W(S);
+    if (W.word(0) != EdgeArrayHeader) {
       cout << "Bad input file" << endl;
       abort();
     }
     long n = (W.size()-1)/2;
-    auto E = parlay::tabulate(n, [&] (long i) -> edge<intV> {
-	return edge<intV>(atol(W[2*i + 1]),
-			  atol(W[2*i + 2]));});
+    auto E = W.parse_fields<edge<intV>>(1, n, 2, [&] (edge<intV> &e, int r, const char* p) {
+	(r == 0 ? e.u : e.v) = parse_long(p, W.end());});
 
     auto mon = parlay::make_monoid([&] (edge<intV> a, edge<intV> b) {
 	return edge<intV>(std::max(a.u, b.u), std::max(a.v, b.v));},
@@ -168,17 +167,17 @@ namespace benchIO {
   template <class intV, class Weight>
   wghEdgeArray<intV,Weight> readWghEdgeArrayFromFile(char* fname) {
     using WE = wghEdge<intV,Weight>;
-    parlay::sequence<char> S = readStringFromFile(fname);
-    parlay::sequence<char*> W = stringToWords(S);
-    if (W[0] != WghEdgeArrayHeader) {
+    auto S = parlay::file_map(fname);
+    textTokens W(S);
+    if (W.word(0) != WghEdgeArrayHeader) {
       cout << "Bad input file" << endl;
       abort();
     }
     long n = (W.size()-1)/3;
-    auto E = parlay::tabulate(n, [&] (size_t i) -> WE {
-	return WE(atol(W[3*i + 1]),
-		  atol(W[3*i + 2]),
-		  (Weight) atof(W[3*i + 3]));});
+    auto E = W.parse_fields<WE>(1, n, 3, [&] (WE &e, int r, const char* p) {
+	if (r == 0) e.u = parse_long(p, W.end());
+	else if (r == 1) e.v = parse_long(p, W.end());
+	else e.weight = (Weight) parse_double(p, W.end());});
 
     auto mon = parlay::make_monoid([&] (WE a, WE b) {
 	return WE(std::max(a.u, b.u), std::max(a.v, b.v), 0);},
@@ -190,26 +189,27 @@ namespace benchIO {
 
   template <class intV, class intE=intV>
   graph<intV, intE> readGraphFromFile(char* fname) {
-    auto W = get_tokens(fname);
-    string header(W[0].begin(), W[0].end());
-    if (header != AdjGraphHeader) {
+    auto S = parlay::file_map(fname);
+    textTokens W(S);
+    if (W.word(0) != AdjGraphHeader) {
       cout << "Bad input file: missing header: " << AdjGraphHeader << endl;
       abort();
     }
 
     // file consists of [type, num_vertices, num_edges, <vertex offsets>, <edges>]
     // in compressed sparse row format
-    long n = parlay::chars_to_long(W[1]);
-    long m = parlay::chars_to_long(W[2]);
+    long n = W.get<long>(1);
+    long m = W.get<long>(2);
     if (W.size() != n + m + 3) {
       cout << "Bad input file: length = "<< W.size() << " n+m+3 = " << n+m+3 << endl;
       abort(); }
     
     // tags on m at the end (so n+1 total offsets)
-    auto offsets = parlay::tabulate(n+1, [&] (size_t i) -> intE {
-	return (i == n) ? m : parlay::chars_to_long(W[i+3]);});
-    auto edges = parlay::tabulate(m, [&] (size_t i) -> intV {
-	return parlay::chars_to_long(W[n+i+3]);});
+    parlay::sequence<intE> offsets(n+1);
+    W.for_tokens(3, n+3, [&] (size_t i, const char* p) {
+	offsets[i-3] = parse_long(p, W.end());});
+    offsets[n] = m;
+    auto edges = W.parse<intV>(n+3, n+m+3);
 
     return graph<intV, intE>(std::move(offsets), std::move(edges), n);
   }
@@ -286,27 +286,27 @@ namespace benchIO {
 
   template <class intV, class Weight, class intE>
   wghGraph<intV, Weight, intE> readWghGraphFromFile(char* fname) {
-    parlay::sequence<char> S = readStringFromFile(fname);
-    parlay::sequence<char*> W = stringToWords(S);
-    if (W[0] != WghAdjGraphHeader) {
+    auto S = parlay::file_map(fname);
+    textTokens W(S);
+    if (W.word(0) != WghAdjGraphHeader) {
       cout << "Bad input file" << endl;
       abort();
     }
 
-    long n = atol(W[1]);
-    long m = atol(W[2]);
+    long n = W.get<long>(1);
+    long m = W.get<long>(2);
     if (W.size() != n + 2*m + 3) {
       cout << "Bad input file: length = "<< W.size()
 	   << " n + 2*m + 3 = " << n+2*m+3 << endl;
       abort(); }
     
     // tags on m at the end (so n+1 total offsets)
-    auto offsets = parlay::tabulate(n+1, [&] (size_t i) -> intE {
-	return (i == n) ? m : atol(W[i+3]);});
-    auto edges = parlay::tabulate(m, [&] (size_t i) -> intV {
-	return atol(W[n+i+3]);});
-    auto weights = parlay::tabulate(m, [&] (size_t i) -> Weight {
-	return (Weight) atof(W[n+i+3+m]);});
+    parlay::sequence<intE> offsets(n+1);
+    W.for_tokens(3, n+3, [&] (size_t i, const char* p) {
+	offsets[i-3] = parse_long(p, W.end());});
+    offsets[n] = m;
+    auto edges = W.parse<intV>(n+3, n+m+3);
+    auto weights = W.parse<Weight>(n+m+3, n+2*m+3);
 
     return wghGraph<intV,Weight,intE>(std::move(offsets),
 				      std::move(edges),
@@ -0,0 +1,269 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef PBBS_PARSETEXT_H_
+#define PBBS_PARSETEXT_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include "../parlay/primitives.h"
+#include "../parlay/parallel.h"
+#include "../parlay/io.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Parsing of the whitespace separated text formats without building
+// an array of words.  The text is cut into blocks and the number of
+// tokens starting in each block is counted in parallel (64 characters
+// at a time, with SSE2 compares when available), which gives the index
+// of the first token of each block.  Numbers are then parsed directly
+// from the text into their place in the output, again in parallel
+// over blocks.  Whitespace is ' ', '\t', '\n', '\r' and 0, as in
+// is_space.
+
+namespace benchIO {
+
+  inline bool is_space_char(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == 0;
+  }
+
+  inline bool is_digit_char(char c) {
+    return (unsigned char) (c - '0') < 10;
+  }
+
+  // bit i is set if p[i] is not whitespace
+  inline uint64_t nonspace_mask(const char* p) {
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i ret = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t r = 0;
+    for (int k = 0; k < 4; k++) {
+      __m128i c = _mm_loadu_si128((const __m128i*) (p + 16 * k));
+      __m128i w = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, space),
+					    _mm_cmpeq_epi8(c, newline)),
+			       _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, ret),
+							 _mm_cmpeq_epi8(c, tab)),
+					    _mm_cmpeq_epi8(c, zero)));
+      r |= ((uint64_t) (uint16_t) ~_mm_movemask_epi8(w)) << (16 * k);
+    }
+    return r;
+#else
+    uint64_t r = 0;
+    for (int i = 0; i < 64; i++)
+      r |= ((uint64_t) !is_space_char(p[i])) << i;
+    return r;
+#endif
+  }
+
+  // same for the last l < 64 characters
+  inline uint64_t nonspace_mask(const char* p, size_t l) {
+    uint64_t r = 0;
+    for (size_t i = 0; i < l; i++)
+      r |= ((uint64_t) !is_space_char(p[i])) << i;
+    return r;
+  }
+
+  // like atol, stopping at the first non digit
+  inline long parse_long(const char* p, const char* end) {
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+    unsigned long r = 0;
+    while (p < end && is_digit_char(*p)) r = 10 * r + (*p++ - '0');
+    return neg ? - (long) r : (long) r;
+  }
+
+  // strtod on a null terminated copy of the token
+  inline double parse_double_slow(const char* p, const char* end) {
+    const char* q = p;
+    while (q < end && !is_space_char(*q)) q++;
+    std::string s(p, q);
+    return strtod(s.c_str(), nullptr);
+  }
+
+  // like atof.  When the digits fit in 53 bits and the power of ten
+  // is at most 22 both are exact doubles, so one multiply or divide
+  // gives the correctly rounded result (Clinger's fast path).  This
+  // covers what the generators write (%.11le).  Anything else goes
+  // to strtod.
+  inline double parse_double(const char* p, const char* end) {
+    static constexpr double powers[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* q = p;
+    bool neg = false;
+    if (q < end && (*q == '-' || *q == '+')) neg = (*q++ == '-');
+    uint64_t m = 0;
+    int digits = 0;    // significant digits in m
+    int exp10 = 0;
+    bool any = false;  // seen a digit
+    bool exact = true; // all digits are in m
+    auto add_digit = [&] (char c) {
+      any = true;
+      if (digits < 19) {
+	m = 10 * m + (c - '0');
+	if (m > 0) digits++;
+      } else exact = false;
+    };
+    while (q < end && is_digit_char(*q)) add_digit(*q++);
+    // hex floats, such as 0x1.8p+1
+    if (q < end && (*q == 'x' || *q == 'X')) return parse_double_slow(p, end);
+    if (q < end && *q == '.') {
+      q++;
+      while (q < end && is_digit_char(*q)) {add_digit(*q++); exp10--;}
+    }
+    if (!any) return parse_double_slow(p, end);
+    if (q < end && (*q == 'e' || *q == 'E')) {
+      q++;
+      bool eneg = false;
+      if (q < end && (*q == '-' || *q == '+')) eneg = (*q++ == '-');
+      int e = 0;
+      while (q < end && is_digit_char(*q)) {
+	if (e < 100000) e = 10 * e + (*q - '0');
+	q++;
+      }
+      exp10 += eneg ? -e : e;
+    }
+    if (!exact || m > (((uint64_t) 1) << 53) || exp10 < -22 || exp10 > 22)
+      return parse_double_slow(p, end);
+    double d = (double) m;
+    d = (exp10 < 0) ? d / powers[-exp10] : d * powers[exp10];
+    return neg ? -d : d;
+  }
+
+  template <class T>
+  inline T parse_number(const char* p, const char* end) {
+    if constexpr (std::is_floating_point<T>::value)
+      return (T) parse_double(p, end);
+    else return (T) parse_long(p, end);
+  }
+
+  // An index of the tokens of a text, which is not copied.
+  struct textTokens {
+    static constexpr size_t block_size = 1 << 16;  // multiple of 64
+
+    const char* s;
+    size_t n;
+    size_t num_blocks;
+    parlay::sequence<size_t> offsets;  // index of first token in each block
+
+    // calls f(j, bits) for each 64 characters starting at j in the
+    // block, with the bits set where a token starts
+    template <class F>
+    void block_starts(size_t b, F f) const {
+      size_t start = b * block_size;
+      size_t last = std::min(n, start + block_size);
+      uint64_t prev = (start > 0 && !is_space_char(s[start - 1])) ? 1 : 0;
+      for (size_t j = start; j < last; j += 64) {
+	uint64_t m = (j + 64 <= n) ? nonspace_mask(s + j) : nonspace_mask(s + j, n - j);
+	f(j, m & ~((m << 1) | prev));
+	prev = m >> 63;
+      }
+    }
+
+    textTokens(const char* s, size_t n)
+      : s(s), n(n), num_blocks((n + block_size - 1) / block_size) {
+      auto counts = parlay::tabulate(num_blocks, [&] (size_t b) -> size_t {
+	  size_t c = 0;
+	  block_starts(b, [&] (size_t j, uint64_t starts) {
+	      c += __builtin_popcountll(starts);});
+	  return c;}, 1);
+      size_t total;
+      std::tie(offsets, total) = parlay::scan(std::move(counts));
+      offsets.push_back(total);
+    }
+
+    template <class Range>
+    textTokens(Range const &S) : textTokens(S.begin(), S.size()) {}
+
+    size_t size() const {return offsets[num_blocks];}
+    const char* end() const {return s + n;}
+
+    // calls f(i, p) in parallel for tokens i in [start, finish), where
+    // p points to the first character of token i
+    template <class F>
+    void for_tokens(size_t start, size_t finish, F f) const {
+      if (start >= finish) return;
+      size_t b0 = std::upper_bound(offsets.begin(), offsets.end(), start) - offsets.begin() - 1;
+      size_t b1 = std::lower_bound(offsets.begin(), offsets.end(), finish) - offsets.begin();
+      b1 = std::min(b1, num_blocks);
+      parlay::parallel_for(b0, b1, [&] (size_t b) {
+	  size_t i = offsets[b];
+	  if (i >= finish || offsets[b + 1] <= start) return;
+	  block_starts(b, [&] (size_t j, uint64_t starts) {
+	      while (starts) {
+		if (i >= start && i < finish) f(i, s + j + __builtin_ctzll(starts));
+		i++;
+		starts &= starts - 1;
+	      }});
+	}, 1);
+    }
+
+    // pointer to the start of token i (sequential)
+    const char* token(size_t i) const {
+      const char* r = nullptr;
+      for_tokens(i, i + 1, [&] (size_t, const char* p) {r = p;});
+      return r;
+    }
+
+    std::string word(size_t i) const {
+      if (i >= size()) return std::string();
+      const char* p = token(i);
+      const char* q = p;
+      while (q < end() && !is_space_char(*q)) q++;
+      return std::string(p, q);
+    }
+
+    template <class T>
+    T get(size_t i) const {return parse_number<T>(token(i), end());}
+
+    // the numbers in tokens [start, finish)
+    template <class T>
+    parlay::sequence<T> parse(size_t start, size_t finish) const {
+      parlay::sequence<T> R(finish - start);
+      for_tokens(start, finish, [&] (size_t i, const char* p) {
+	  R[i - start] = parse_number<T>(p, end());});
+      return R;
+    }
+
+    // m elements of k tokens each starting at token start, where
+    // f(x, r, p) sets field r of element x from the token at p
+    template <class T, class F>
+    parlay::sequence<T> parse_fields(size_t start, size_t m, int k, F f) const {
+      parlay::sequence<T> R(m);
+      for_tokens(start, start + k * m, [&] (size_t i, const char* p) {
+	  size_t j = i - start;
+	  f(R[j / k], j % k, p);});
+      return R;
+    }
+  };
+
+};
+
+#endif
@@ -0,0 +1,279 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifndef PBBS_PERF_COUNTERS_H_
+#define PBBS_PERF_COUNTERS_H_
+
+// Hardware counters for the phases of a timer.
+// Compiled in with -DPERF_COUNTERS (make PERF_COUNTERS=1), otherwise
+// all calls are empty and perf::timer is parlay::internal::timer.
+
+// Public interface:
+//   perf::read() : counts so far, summed over all threads
+//   perf::phase(timer_name, phase_name, seconds, last) : adds the
+//      counts since last to the phase, and returns the current counts
+//   perf::report() : prints a table with a row per phase, run at exit
+//   perf::timer : parlay::internal::timer that records each next()
+//   perf::enabled : true when compiled in, e.g. to start a timer
+// The timer in common/get_time.h records its phases as well.
+
+// The counters are cycles, instructions, last level cache misses, data
+// TLB misses and branch misses, opened with perf_event_open on every
+// thread of the process on first use.  They are inherited, so threads
+// created later are included.  Only user mode is counted, so this
+// works with perf_event_paranoid up to 2.  If PBBS_PERF_JSON is set
+// in the environment the table is also written as json to that file.
+
+#include <string>
+#include "../parlay/internal/get_time.h"
+
+#ifdef PERF_COUNTERS
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace pbbs {
+namespace perf {
+
+  enum event {cycles, instructions, llc_misses, dtlb_misses, branch_misses,
+	      num_events};
+
+  struct counts {
+    double v[num_events] = {};
+  };
+
+#ifdef PERF_COUNTERS
+  constexpr bool enabled = true;
+#else
+  constexpr bool enabled = false;
+#endif
+
+#ifdef PERF_COUNTERS
+
+  inline const char* event_name(int e) {
+    const char* names[] = {"cycles", "instructions", "llc_misses",
+			   "dtlb_misses", "branch_misses"};
+    return names[e];
+  }
+
+  struct phase_counts {
+    std::string name;
+    long calls = 0;
+    double time = 0.0;
+    counts c;
+  };
+
+  struct state {
+    std::mutex m;
+    bool opened = false;
+    bool have[num_events] = {};
+    std::vector<int> fds[num_events];
+    std::vector<phase_counts> phases;  // in order of first use
+  };
+
+  inline state& get_state() {static state s; return s;}
+
+  inline int open_event(int e, pid_t tid) {
+    perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.inherit = 1;
+    a.exclude_kernel = 1;
+    a.exclude_hv = 1;
+    a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    auto cache_miss = [] (int cache) -> uint64_t {
+      return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);};
+    switch (e) {
+    case cycles:
+      a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case instructions:
+      a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case llc_misses:
+      a.type = PERF_TYPE_HW_CACHE; a.config = cache_miss(PERF_COUNT_HW_CACHE_LL); break;
+    case dtlb_misses:
+      a.type = PERF_TYPE_HW_CACHE; a.config = cache_miss(PERF_COUNT_HW_CACHE_DTLB); break;
+    default:
+      a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    }
+    return syscall(SYS_perf_event_open, &a, tid, -1, -1, 0);
+  }
+
+  // an event is used if it can be opened on the first thread
+  inline void open_all(state &s) {
+    s.opened = true;
+    std::vector<pid_t> tids;
+    if (DIR* d = opendir("/proc/self/task")) {
+      while (dirent* f = readdir(d))
+	if (f->d_name[0] != '.') tids.push_back(atoi(f->d_name));
+      closedir(d);
+    }
+    for (int e = 0; e < num_events; e++) {
+      for (size_t i = 0; i < tids.size(); i++) {
+	int fd = open_event(e, tids[i]);
+	if (fd >= 0) s.fds[e].push_back(fd);
+	else if (i == 0) {
+	  std::cout << "perf counters: cannot count " << event_name(e) << ": "
+		    << strerror(errno) << std::endl;
+	  break;
+	}
+      }
+      s.have[e] = s.fds[e].size() > 0;
+    }
+  }
+
+  inline counts read() {
+    state &s = get_state();
+    std::lock_guard<std::mutex> g(s.m);
+    if (!s.opened) open_all(s);
+    counts r;
+    for (int e = 0; e < num_events; e++)
+      for (int fd : s.fds[e]) {
+	uint64_t buf[3];  // value, time enabled, time running
+	if (::read(fd, buf, sizeof(buf)) == sizeof(buf) && buf[2] > 0)
+	  r.v[e] += buf[0] * ((double) buf[1] / buf[2]);
+      }
+    return r;
+  }
+
+  inline void report();
+
+  inline counts phase(std::string const &timer_name, std::string const &phase_name,
+		      double time, counts const &last) {
+    counts now = read();
+    state &s = get_state();
+    std::lock_guard<std::mutex> g(s.m);
+    std::string name = timer_name + ": " + phase_name;
+    size_t i = 0;
+    while (i < s.phases.size() && s.phases[i].name != name) i++;
+    if (i == s.phases.size()) {
+      if (i == 0) std::atexit(report);
+      s.phases.push_back(phase_counts{name});
+    }
+    phase_counts &p = s.phases[i];
+    p.calls++;
+    p.time += time;
+    for (int e = 0; e < num_events; e++) p.c.v[e] += now.v[e] - last.v[e];
+    return now;
+  }
+
+  inline void write_json(state &s, char const *fileName) {
+    std::ofstream out(fileName);
+    if (!out.is_open()) {
+      std::cout << "perf counters: unable to open " << fileName << std::endl;
+      return;
+    }
+    out << "[" << std::endl;
+    for (size_t i = 0; i < s.phases.size(); i++) {
+      phase_counts &p = s.phases[i];
+      out << "  {\"phase\": \"" << p.name << "\", \"calls\": " << p.calls
+	  << ", \"time\": " << p.time;
+      for (int e = 0; e < num_events; e++)
+	if (s.have[e]) out << ", \"" << event_name(e) << "\": " << (long) p.c.v[e];
+      out << "}" << (i + 1 < s.phases.size() ? "," : "") << std::endl;
+    }
+    out << "]" << std::endl;
+  }
+
+  // counts in millions, and instructions per cycle
+  inline void report() {
+    state &s = get_state();
+    std::lock_guard<std::mutex> g(s.m);
+    if (s.phases.size() == 0) return;
+    size_t w = 5;
+    for (auto &p : s.phases) w = std::max(w, p.name.size());
+    const char* headers[] = {"cycles", "instrs", "LLC miss", "dTLB miss", "br miss"};
+    std::ios::fmtflags cout_settings = std::cout.flags();
+    std::cout << "perf counters per phase (millions, summed over threads)" << std::endl;
+    std::cout << std::left << std::setw(w) << "phase" << std::right
+	      << std::setw(7) << "calls" << std::setw(10) << "time";
+    for (int e = 0; e < num_events; e++)
+      if (s.have[e]) std::cout << std::setw(11) << headers[e];
+    if (s.have[cycles] && s.have[instructions]) std::cout << std::setw(6) << "IPC";
+    std::cout << std::endl << std::fixed;
+    for (auto &p : s.phases) {
+      std::cout << std::left << std::setw(w) << p.name << std::right
+		<< std::setw(7) << p.calls << std::setw(10) << std::setprecision(4) << p.time;
+      for (int e = 0; e < num_events; e++)
+	if (s.have[e]) std::cout << std::setw(11) << std::setprecision(1) << p.c.v[e] / 1e6;
+      if (s.have[cycles] && s.have[instructions])
+	std::cout << std::setw(6) << std::setprecision(2)
+		  << p.c.v[instructions] / std::max(p.c.v[cycles], 1.0);
+      std::cout << std::endl;
+    }
+    std::cout.flags(cout_settings);
+    if (char const *f = getenv("PBBS_PERF_JSON")) write_json(s, f);
+  }
+
+  // records a phase at each next() while started
+  struct timer : parlay::internal::timer {
+    using clock = std::chrono::steady_clock;
+    std::string name;
+    bool on = false;
+    clock::time_point last_time;
+    counts last;
+
+    void mark() {on = true; last_time = clock::now(); last = perf::read();}
+
+    timer(std::string name = "Parlay time", bool start_ = true)
+      : parlay::internal::timer(name, start_), name(name) {
+      if (start_) mark();
+    }
+
+    void start() {parlay::internal::timer::start(); mark();}
+
+    auto stop() {on = false; return parlay::internal::timer::stop();}
+
+    void next(std::string str) {
+      if (on) {
+	auto now = clock::now();
+	double d = std::chrono::duration<double>(now - last_time).count();
+	last = perf::phase(name, str, d, last);
+	last_time = now;
+      }
+      parlay::internal::timer::next(str);
+    }
+  };
+
+#else
+
+  inline counts read() {return counts();}
+  inline counts phase(std::string const &timer_name, std::string const &phase_name,
+		      double time, counts const &last) {return last;}
+  inline void report() {}
+  using timer = parlay::internal::timer;
+
+#endif
+
+} // namespace perf
+} // namespace pbbs
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef PBBS_PREDICATES_H_
+#define PBBS_PREDICATES_H_
+
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+// *************************************************************
+//    ROBUST PREDICATES
+// *************************************************************
+
+// Orientation, in-circle and in-sphere tests whose sign is always
+// exact.  Each test is first evaluated in double precision along with
+// a bound on its rounding error (Shewchuk's error bounds), which
+// settles almost all calls.  Only if the result is within the bound is
+// it recomputed exactly, using expansions: sums of doubles that do not
+// overlap, in increasing magnitude.  The exact stage is adaptive in
+// that differences that are already exact (the common case for nearby
+// points) stay single doubles and keep the expansions short.
+// The conventions follow Shewchuk's predicates.  The point versions
+// (orient2d, incircle, orient3d and insphere) are in geometry.h.
+
+namespace predicates {
+  // A sequence of doubles kept on the stack while it is short, which
+  // it is for most of the exact evaluations that are needed (e.g. when
+  // the coordinate differences are exact).
+  class expansion {
+    static constexpr size_t inline_size = 8;
+    size_t n = 0;
+    bool is_large = false;
+    double small[inline_size];
+    std::vector<double> large;
+  public:
+    size_t size() const {return n;}
+    double const* begin() const {return is_large ? large.data() : small;}
+    double const* end() const {return begin() + n;}
+    double* begin() {return is_large ? large.data() : small;}
+    double* end() {return begin() + n;}
+    double operator[](size_t i) const {return begin()[i];}
+    double back() const {return begin()[n-1];}
+    void push_back(double x) {
+      if (!is_large && n < inline_size) {small[n++] = x; return;}
+      if (!is_large) {large.assign(small, small + n); is_large = true;}
+      large.push_back(x);
+      n++;
+    }
+  };
+
+  constexpr double epsilon = DBL_EPSILON / 2;
+  constexpr double o2d_bound = (3.0 + 16.0 * epsilon) * epsilon;
+  constexpr double icc_bound = (10.0 + 96.0 * epsilon) * epsilon;
+  constexpr double o3d_bound = (7.0 + 56.0 * epsilon) * epsilon;
+  constexpr double isp_bound = (16.0 + 224.0 * epsilon) * epsilon;
+
+  inline void two_sum(double a, double b, double& x, double& y) {
+    x = a + b;
+    double bv = x - a;
+    double av = x - bv;
+    y = (a - av) + (b - bv);
+  }
+
+  inline void fast_two_sum(double a, double b, double& x, double& y) {
+    x = a + b;
+    y = b - (x - a);
+  }
+
+  inline void two_diff(double a, double b, double& x, double& y) {
+    x = a - b;
+    double bv = a - x;
+    double av = x + bv;
+    y = (a - av) + (bv - b);
+  }
+
+  inline void two_product(double a, double b, double& x, double& y) {
+    x = a * b;
+    y = std::fma(a, b, -x);
+  }
+
+  // a - b exactly
+  inline expansion diff(double a, double b) {
+    double x, y;
+    two_diff(a, b, x, y);
+    expansion e;
+    if (y != 0.0) e.push_back(y);
+    if (x != 0.0) e.push_back(x);
+    return e;
+  }
+
+  // e + b
+  inline expansion grow(expansion const &e, double b) {
+    expansion h;
+    double q = b;
+    for (double ei : e) {
+      double hh;
+      two_sum(q, ei, q, hh);
+      if (hh != 0.0) h.push_back(hh);
+    }
+    if (q != 0.0) h.push_back(q);
+    return h;
+  }
+
+  inline expansion sum(expansion const &e, expansion const &f) {
+    expansion h = e;
+    for (double fi : f) h = grow(h, fi);
+    return h;
+  }
+
+  inline expansion negate(expansion e) {
+    for (double& x : e) x = -x;
+    return e;
+  }
+
+  inline expansion scale(expansion const &e, double b) {
+    expansion h;
+    if (e.size() == 0 || b == 0.0) return h;
+    double q, hh;
+    two_product(e[0], b, q, hh);
+    if (hh != 0.0) h.push_back(hh);
+    for (size_t i = 1; i < e.size(); i++) {
+      double p1, p0, s;
+      two_product(e[i], b, p1, p0);
+      two_sum(q, p0, s, hh);
+      if (hh != 0.0) h.push_back(hh);
+      fast_two_sum(p1, s, q, hh);
+      if (hh != 0.0) h.push_back(hh);
+    }
+    if (q != 0.0) h.push_back(q);
+    return h;
+  }
+
+  inline expansion product(expansion const &e, expansion const &f) {
+    expansion h;
+    for (double fi : f) h = sum(h, scale(e, fi));
+    return h;
+  }
+
+  // the largest component, which has the sign of the expansion
+  inline double estimate(expansion const &e) {
+    return (e.size() == 0) ? 0.0 : e.back();
+  }
+
+  // a*d - b*c
+  inline expansion cross(expansion const &a, expansion const &b,
+			 expansion const &c, expansion const &d) {
+    return sum(product(a, d), negate(product(b, c)));
+  }
+
+  // (l + l0) - (r + r0) as four non-overlapping components in x, from
+  // smallest to largest (Shewchuk's Two_Two_Diff), some of which can
+  // be zero
+  inline void two_two_diff(double l, double l0, double r, double r0, double* x) {
+    double i, j, k;
+    two_diff(l0, r0, i, x[0]);
+    two_sum(l, i, j, k);
+    two_diff(k, r, i, x[1]);
+    two_sum(j, i, x[3], x[2]);
+  }
+
+  // a*d - b*c exactly for doubles a, b, c and d
+  inline void two_by_two(double a, double b, double c, double d, double* x) {
+    double l, l0, r, r0;
+    two_product(a, d, l, l0);
+    two_product(b, c, r, r0);
+    two_two_diff(l, l0, r, r0, x);
+  }
+
+  // The same as scale and grow but on short expansions kept in arrays,
+  // returning the new length.  h needs room for 2 * elen components.
+  inline int scale_array(int elen, double const* e, double b, double* h) {
+    int hlen = 0;
+    double q, hh;
+    two_product(e[0], b, q, hh);
+    if (hh != 0.0) h[hlen++] = hh;
+    for (int i = 1; i < elen; i++) {
+      double p1, p0, s;
+      two_product(e[i], b, p1, p0);
+      two_sum(q, p0, s, hh);
+      if (hh != 0.0) h[hlen++] = hh;
+      fast_two_sum(p1, s, q, hh);
+      if (hh != 0.0) h[hlen++] = hh;
+    }
+    if (q != 0.0) h[hlen++] = q;
+    return hlen;
+  }
+
+  // h += f in place, where h needs room for hlen + flen components
+  inline int sum_array(int hlen, double* h, int flen, double const* f) {
+    for (int i = 0; i < flen; i++) {
+      double q = f[i];
+      int k = 0;
+      for (int j = 0; j < hlen; j++) {
+	double hh;
+	two_sum(q, h[j], q, hh);
+	if (hh != 0.0) h[k++] = hh;
+      }
+      if (q != 0.0) h[k++] = q;
+      hlen = k;
+    }
+    return hlen;
+  }
+
+  // the largest non-zero of the components from smallest to largest
+  inline double estimate(int n, double const* x) {
+    for (int i = n-1; i >= 0; i--)
+      if (x[i] != 0.0) return x[i];
+    return 0.0;
+  }
+
+  inline double orient2d_exact(double const* a, double const* b, double const* c) {
+    double acx0, acx1, acy0, acy1, bcx0, bcx1, bcy0, bcy1;
+    two_diff(a[0], c[0], acx0, acx1); two_diff(a[1], c[1], acy0, acy1);
+    two_diff(b[0], c[0], bcx0, bcx1); two_diff(b[1], c[1], bcy0, bcy1);
+    // usually the differences are exact and the determinant is
+    // the difference of two exact products
+    if (acx1 == 0.0 && acy1 == 0.0 && bcx1 == 0.0 && bcy1 == 0.0) {
+      double x[4];
+      two_by_two(acx0, acy0, bcx0, bcy0, x);
+      return estimate(4, x);
+    }
+    expansion acx = diff(a[0], c[0]), acy = diff(a[1], c[1]);
+    expansion bcx = diff(b[0], c[0]), bcy = diff(b[1], c[1]);
+    return estimate(cross(acx, acy, bcx, bcy));
+  }
+
+  inline double incircle_exact(double const* a, double const* b,
+			       double const* c, double const* d) {
+    expansion x[3], y[3], lift[3];
+    double const* p[3] = {a, b, c};
+    for (int i = 0; i < 3; i++) {
+      x[i] = diff(p[i][0], d[0]);
+      y[i] = diff(p[i][1], d[1]);
+      lift[i] = sum(product(x[i], x[i]), product(y[i], y[i]));
+    }
+    expansion r = product(lift[0], cross(x[1], x[2], y[1], y[2]));
+    r = sum(r, product(lift[1], cross(x[2], x[0], y[2], y[0])));
+    r = sum(r, product(lift[2], cross(x[0], x[1], y[0], y[1])));
+    return estimate(r);
+  }
+
+  inline double orient3d_exact(double const* a, double const* b,
+			       double const* c, double const* d) {
+    double dx[3][2], dy[3][2], dz[3][2];
+    double const* p[3] = {a, b, c};
+    bool exact = true;
+    for (int i = 0; i < 3; i++) {
+      two_diff(p[i][0], d[0], dx[i][0], dx[i][1]);
+      two_diff(p[i][1], d[1], dy[i][0], dy[i][1]);
+      two_diff(p[i][2], d[2], dz[i][0], dz[i][1]);
+      exact = exact && dx[i][1] == 0.0 && dy[i][1] == 0.0 && dz[i][1] == 0.0;
+    }
+    // usually the differences are exact, and the determinant is
+    // a sum of three exact minors each scaled by a double
+    if (exact) {
+      double minor[4], t[8], r[24];
+      two_by_two(dx[1][0], dy[1][0], dx[2][0], dy[2][0], minor);
+      int rlen = scale_array(4, minor, dz[0][0], r);
+      two_by_two(dx[2][0], dy[2][0], dx[0][0], dy[0][0], minor);
+      rlen = sum_array(rlen, r, scale_array(4, minor, dz[1][0], t), t);
+      two_by_two(dx[0][0], dy[0][0], dx[1][0], dy[1][0], minor);
+      rlen = sum_array(rlen, r, scale_array(4, minor, dz[2][0], t), t);
+      return estimate(rlen, r);
+    }
+    expansion adx = diff(a[0], d[0]), ady = diff(a[1], d[1]), adz = diff(a[2], d[2]);
+    expansion bdx = diff(b[0], d[0]), bdy = diff(b[1], d[1]), bdz = diff(b[2], d[2]);
+    expansion cdx = diff(c[0], d[0]), cdy = diff(c[1], d[1]), cdz = diff(c[2], d[2]);
+    expansion r = product(adz, cross(bdx, bdy, cdx, cdy));
+    r = sum(r, product(bdz, cross(cdx, cdy, adx, ady)));
+    r = sum(r, product(cdz, cross(adx, ady, bdx, bdy)));
+    return estimate(r);
+  }
+
+  inline double insphere_exact(double const* a, double const* b, double const* c,
+			       double const* d, double const* e) {
+    expansion x[4], y[4], z[4], lift[4];
+    double const* p[4] = {a, b, c, d};
+    for (int i = 0; i < 4; i++) {
+      x[i] = diff(p[i][0], e[0]);
+      y[i] = diff(p[i][1], e[1]);
+      z[i] = diff(p[i][2], e[2]);
+      lift[i] = sum(sum(product(x[i], x[i]), product(y[i], y[i])), product(z[i], z[i]));
+    }
+    // 2x2 minors of the x and y columns, then 3x3 minors with z
+    expansion ab = cross(x[0], x[1], y[0], y[1]);
+    expansion bc = cross(x[1], x[2], y[1], y[2]);
+    expansion cd = cross(x[2], x[3], y[2], y[3]);
+    expansion da = cross(x[3], x[0], y[3], y[0]);
+    expansion ac = cross(x[0], x[2], y[0], y[2]);
+    expansion bd = cross(x[1], x[3], y[1], y[3]);
+    expansion abc = sum(sum(product(z[0], bc), negate(product(z[1], ac))), product(z[2], ab));
+    expansion bcd = sum(sum(product(z[1], cd), negate(product(z[2], bd))), product(z[3], bc));
+    expansion cda = sum(sum(product(z[2], da), product(z[3], ac)), product(z[0], cd));
+    expansion dab = sum(sum(product(z[3], ab), product(z[0], bd)), product(z[1], da));
+    expansion r = sum(product(lift[3], abc), negate(product(lift[2], dab)));
+    r = sum(r, sum(product(lift[1], cda), negate(product(lift[0], bcd))));
+    return estimate(r);
+  }
+}
+
+#endif // PBBS_PREDICATES_H_
@@ -2,6 +2,7 @@ import subprocess
 import sys
 import random
 import os
+import re
 
 def onPprocessors(command,p) :
   if "OPENMP" in os.environ:
@@ -38,21 +39,105 @@ def runSingle(runProgram, options, ifile, procs) :
   except (ValueError,IndexError):
     raise NameError(comString+"\n"+out)
 
+# For weak scaling.  The size of an input is the largest token of its
+# name (split at '_') that is a number of at least 1000, possibly with
+# a K or M suffix, e.g. 100M in randomSeq_100M_int.  Returns the index
+# of the token and the size, or None if there is none.
+def sizeToken(name) :
+  best = None
+  tokens = name.split('_')
+  for i in range(len(tokens)) :
+    m = re.fullmatch(r'(\d+)([KM]?)', tokens[i])
+    if m :
+      n = int(m.group(1)) * {'': 1, 'K': 1000, 'M': 1000000}[m.group(2)]
+      if n >= 1000 and (best == None or n > best[1]) :
+        best = (i, n)
+  return best
+
+# Replaces the size argument of a generator command that writes name:
+# the last n (or token) before name, which is the last word or follows
+# >.  Other numbers equal to n, e.g. a range, are left alone, except in
+# an edge count given as `expr c \* n`.
+def scaleSizeArgument(line, name, token, n, m) :
+  words = line.split(' ')
+  if name in words :
+    out = len(words) - 1 - words[::-1].index(name)
+    for i in range(out - 1, -1, -1) :
+      if words[i] in (str(n), token) :
+        words[i] = str(m)
+        break
+  line = ' '.join(words)
+  return re.sub(r'(`expr [0-9]+ \\\* )' + str(n) + '`', r'\g<1>' + str(m) + '`', line)
+
+# Generates the input name at size m instead of n, where token is how
+# n appears in names, by running the data directory's recipe for name
+# (from make -n) with the size replaced.
+def makeScaled(dataDir, name, token, n, m) :
+  recipe = shellGetOutput("cd " + dataDir + "; make -B -n " + name)
+  for line in recipe.split('\n') :
+    if len(line) == 0 : continue
+    if line.startswith("make ") :
+      makeScaled(dataDir, line.split()[-1], token, n, m)
+      continue
+    line = scaleSizeArgument(line, name, token, n, m)
+    line = re.sub(r'(?<=_)' + re.escape(token) + r'(?![0-9A-Za-z])', str(m), line)
+    if os.system("cd " + dataDir + "; " + line) :
+      raise NameError("could not generate scaled input: " + line)
+
+# Makes the input name scaled to the given fraction of its size.
+# Returns the name of the scaled input and its size (None if the name
+# has no size, in which case the input is made as is).
+def makeInput(dataDir, name, fraction) :
+  t = sizeToken(name)
+  if t == None or fraction == 1.0 :
+    shellGetOutput("cd " + dataDir + "; make " + name)
+    return (name, None if t == None else t[1])
+  (i, n) = t
+  m = max(1, int(n * fraction))
+  tokens = name.split('_')
+  token = tokens[i]
+  tokens[i] = str(m)
+  scaledName = '_'.join(tokens)
+  makeScaled(dataDir, name, token, n, m)
+  return (scaledName, m)
+
+# Appends a line per run to a csv file, with a header if it is new.
+# Times are the minimum and geometric mean over the rounds.
+def addToTable(csvFile, inputFileNames, size, procs, times) :
+  impl = "/".join(os.getcwd().split('/')[-2:])
+  new = not(os.path.exists(csvFile))
+  with open(csvFile, "a") as f :
+    if new :
+      f.write("implementation,input,size,threads,min,geomean\n")
+    f.write(",".join([impl, "+".join(inputFileNames),
+                      "" if size == None else repr(size),
+                      "" if procs == 0 else repr(procs),
+                      repr(min(times)), repr(geomean(times))]) + "\n")
+
 def geomean(a) :
   r = 1.0
   for x in a :
     r = r * x
   return r**(1.0/len(a))
 
-def runTest(runProgram, checkProgram, dataDir, test, rounds, procs, noOutput, keepData) :
+def runTest(runProgram, checkProgram, dataDir, test, rounds, procs, noOutput, keepData,
+            csvFile=None, weak=0.0) :
     random.seed()
     outFile="/tmp/ofile%d_%d" %(random.randint(0, 1000000), random.randint(0, 1000000)) 
     [weight, inputFileNames, runOptions, checkOptions] = test
     if type(inputFileNames) is str :
       inputFileNames = [inputFileNames]
+    baseInputNames = inputFileNames
+    size = None
+    if weak > 0.0 and len(dataDir)>0:
+      made = [makeInput(dataDir, name, weak) for name in inputFileNames]
+      inputFileNames = [name for (name, n) in made]
+      size = made[0][1]
+    elif len(dataDir)>0:
+      out = shellGetOutput("cd " + dataDir + "; make " + " ".join(inputFileNames))
+      t = sizeToken(inputFileNames[0])
+      if t != None : size = t[1]
     shortInputNames = " ".join(inputFileNames)
-    if len(dataDir)>0:
-      out = shellGetOutput("cd " + dataDir + "; make " + shortInputNames)
     longInputNames = " ".join(dataDir + "/" + name for name in inputFileNames)
     runOptions = runOptions + " -r " + repr(rounds)
     if (noOutput == 0) :
@@ -77,18 +162,20 @@ def runTest(runProgram, checkProgram, dataDir, test, rounds, procs, noOutput, ke
       outputStr = " : " + runOptions
     print(shortInputNames + outputStr + " : "
           + ptimes + ", geomean = " + stripFloat(geomean(times)))
+    if csvFile != None :
+      addToTable(csvFile, baseInputNames, size, procs, times)
     return [weight,times]
     
 def averageTime(times) :
     return sum(times)/len(times)
     
 def timeAll(name, runProgram, checkProgram, dataDir, tests, rounds, procs, noOutput,
-            addToDatabase, problem, keepData) :
+            addToDatabase, problem, keepData, csvFile=None, weak=0.0) :
   totalTime = 0
   totalWeight = 0
   try:
     results = [runTest(runProgram, checkProgram, dataDir, test, rounds, procs,
-                       noOutput, keepData)
+                       noOutput, keepData, csvFile, weak)
                for test in tests]
     meanOfMeans = geomean([geomean(times) for (w,times) in results])
     meanOfMins = geomean([sorted(times)[0] for (w,times) in results])
@@ -132,14 +219,19 @@ def getArgs() :
   processors = int(getArg("-p", 0))
   rounds = int(getArg("-r", 1))
   keep = getOption("-k")
-  return (noOutput, rounds, addToDatabase, processors, keep)
+  # -csv <file> appends the times to a table, and -weak <f> scales
+  # the input sizes by f (for weak scaling)
+  csvFile = getArg("-csv", None)
+  weak = float(getArg("-weak", 0.0))
+  return (noOutput, rounds, addToDatabase, processors, keep, csvFile, weak)
 
 def timeAllArgs(runProgram, problem, checkProgram, dataDir, tests, keepInputData=False) :
   keepData = keepInputData
-  (noOutput, rounds, addToDatabase, procs, keep) = getArgs()
+  (noOutput, rounds, addToDatabase, procs, keep, csvFile, weak) = getArgs()
   keep = keepInputData or keep
   name = os.path.basename(os.getcwd())
-  timeAll(name, runProgram, checkProgram, dataDir, tests, rounds, procs, noOutput, addToDatabase, problem, keep)
+  timeAll(name, runProgram, checkProgram, dataDir, tests, rounds, procs, noOutput, addToDatabase, problem, keep,
+          csvFile, weak)
 
 #
 # Database insertions
@@ -93,6 +93,11 @@ namespace benchIO {
     else return none;
   }
 
+  // element type of a text or binary sequence file
+  inline elementType elementTypeFromFile(char const *fileName) {
+    return elementTypeFromHeader(fileKind(fileName));
+  }
+
   template <typename Range>
   elementType elementTypeFromString(Range R) {
     string s(R.begin(), R.end());
@@ -167,10 +172,9 @@ namespace benchIO {
   //   return sequence<stringIntPair>(0);
   // }  
 
-  template <typename T, typename CharRange>
-  void check_header(CharRange& S) {
+  template <typename T>
+  void check_header(string const &header) {
     T a;
-    string header(S[0].begin(), S[0].end());
     string type_str = seqHeader(dataType(a));
     if (header != type_str) {
       cout << "bad header: expected " << type_str << " got " << header << endl;
@@ -178,17 +182,45 @@ namespace benchIO {
     }
   }
 
-  // reads file, tokenizes and then dispatches to specialized parsing function
+  // numbers and pairs of numbers are parsed directly from the text
+  template <typename T>
+  sequence<T> parseTokens(textTokens const &W) {
+    if constexpr (std::is_arithmetic<T>::value)
+      return W.parse<T>(1, W.size());
+    else {
+      using A = typename T::first_type;
+      using B = typename T::second_type;
+      return W.parse_fields<T>(1, (W.size()-1)/2, 2, [&] (T &x, int r, const char* p) {
+	  if (r == 0) x.first = parse_number<A>(p, W.end());
+	  else x.second = parse_number<B>(p, W.end());});
+    }
+  }
+
+  // reads a binary or text file, for text dispatches to specialized
+  // parsing function, strings are tokenized first
   template <typename T>
   sequence<T> readSequenceFromFile(char const *fileName) {
-    auto S = get_tokens(fileName);
-    check_header<T>(S[0]);
-    return parseElements<T>(S.cut(1,S.size()));
+    if (isBinaryFile(fileName)) {
+      T a;
+      return readBinarySequence<T>(seqHeader(dataType(a)), fileName);
+    }
+    if constexpr (std::is_same<T, charSeq>::value) {
+      auto S = get_tokens(fileName);
+      check_header<T>(string(S[0].begin(), S[0].end()));
+      return parseElements<T>(S.cut(1,S.size()));
+    } else {
+      auto S = parlay::file_map(fileName);
+      textTokens W(S);
+      check_header<T>(W.word(0));
+      return parseTokens<T>(W);
+    }
   }
   
   template <class T>
   int writeSequenceToFile(sequence<T> const &A, char const *fileName) {
     elementType tp = dataType(A[0]);
+    if (binaryFileName(fileName))
+      return writeBinarySequence(seqHeader(tp), A, fileName);
     return writeSeqToFile(seqHeader(tp), A, fileName);
   }
 
@@ -0,0 +1,78 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _SPATIAL_SORT_INCLUDED
+#define _SPATIAL_SORT_INCLUDED
+
+#include <cstdint>
+#include "../parlay/primitives.h"
+#include "../parlay/utilities.h"
+#include "geometry.h"
+
+// *************************************************************
+//    SPATIAL SORTING OF 2D POINTS
+// *************************************************************
+
+// Position of (x,y) along the Hilbert curve over a 2^bits by 2^bits grid
+inline uint64_t hilbert_key(uint32_t x, uint32_t y, int bits) {
+  uint64_t d = 0;
+  for (uint32_t s = ((uint32_t) 1) << (bits - 1); s > 0; s >>= 1) {
+    uint32_t rx = (x & s) > 0;
+    uint32_t ry = (y & s) > 0;
+    d += ((uint64_t) s) * s * ((3 * rx) ^ ry);
+    // rotate the quadrant so the curve is continuous
+    if (ry == 0) {
+      if (rx == 1) {x = s - 1 - (x & (s - 1)); y = s - 1 - (y & (s - 1));}
+      std::swap(x, y);
+    }
+    x &= s - 1; y &= s - 1;
+  }
+  return d;
+}
+
+// Hilbert keys of the points on a grid over their bounding box
+template <class coord>
+parlay::sequence<uint64_t> hilbert_keys(parlay::sequence<point2d<coord>> const &P,
+					int bits = 20) {
+  using point = point2d<coord>;
+  auto min = [] (point x, point y) { return x.minCoords(y);};
+  auto max = [] (point x, point y) { return x.maxCoords(y);};
+  point min_corner = parlay::reduce(P, parlay::make_monoid(min, P[0]));
+  point max_corner = parlay::reduce(P, parlay::make_monoid(max, P[0]));
+  double delta = std::max(max_corner.x - min_corner.x, max_corner.y - min_corner.y);
+  if (delta == 0) delta = 1;
+  double scale = (((uint64_t) 1 << bits) - 1) / delta;
+  return parlay::tabulate(P.size(), [&] (size_t i) {
+    uint32_t x = (uint32_t) ((P[i].x - min_corner.x) * scale);
+    uint32_t y = (uint32_t) ((P[i].y - min_corner.y) * scale);
+    return hilbert_key(x, y, bits);});
+}
+
+// Indices of the points in Hilbert order
+template <class coord>
+parlay::sequence<size_t> hilbert_order(parlay::sequence<point2d<coord>> const &P) {
+  auto keys = hilbert_keys(P);
+  return parlay::integer_sort(parlay::iota<size_t>(P.size()),
+			      [&] (size_t i) {return keys[i];});
+}
+
+#endif // _SPATIAL_SORT_INCLUDED
@@ -0,0 +1,294 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include "parlay/primitives.h"
+#include "parlay/sequence.h"
+#include "parlay/utilities.h"
+
+// Parallel string sorting over strings held in one contiguous arena.
+// Strings are referred to by handles holding an offset, a length and
+// the position of the string in the input.  Both sorts compare 8
+// characters at a time, as a big-endian integer read at the current
+// depth, and only recompare the shared prefix of two strings at the
+// boundaries of the groups they recurse on.
+//
+//   radix_sort(A) : MSD radix sort, returns the sorted handles
+//   sample_sort(A) : string sample sort, returns the sorted handles
+//      and the lcp array (lcp[i] is the longest common prefix of
+//      strings i-1 and i, and lcp[0] = 0)
+//
+// Characters are ordered as char is (signed on most machines), so the
+// order is the same as comparing the chars of two strings one at a
+// time, with a proper prefix first.
+namespace string_sort {
+
+  struct string_ref {
+    size_t offset;        // start in the arena
+    unsigned int length;
+    unsigned int id;      // position in the input
+  };
+
+  using lcp_t = unsigned int;
+
+  struct arena {
+    parlay::sequence<char> chars;
+    parlay::sequence<string_ref> strs;
+
+    arena() {}
+
+    // S is a random access range of strings (e.g. parlay::chars)
+    template <class Strings>
+    arena(Strings const &S) {
+      size_t n = S.size();
+      if (n >= (((size_t) 1) << 32)) {
+	std::cout << "string_sort: too many strings" << std::endl;
+	abort();
+      }
+      auto offsets = parlay::tabulate(n, [&] (size_t i) {
+	  return (size_t) S[i].size();});
+      if (parlay::reduce(offsets, parlay::maxm<size_t>()) >= (((size_t) 1) << 32)) {
+	std::cout << "string_sort: string too long" << std::endl;
+	abort();
+      }
+      size_t m = parlay::scan_inplace(offsets);
+      chars = parlay::sequence<char>::uninitialized(m);
+      strs = parlay::tabulate(n, [&] (size_t i) {
+	  size_t l = S[i].size();
+	  std::copy(S[i].begin(), S[i].end(), chars.begin() + offsets[i]);
+	  return string_ref{offsets[i], (unsigned int) l, (unsigned int) i};});
+    }
+
+    size_t size() const {return strs.size();}
+    const char* begin(string_ref s) const {return chars.data() + s.offset;}
+  };
+
+  using refs = parlay::slice<string_ref*, string_ref*>;
+
+  // the 8 characters of s starting at depth as a big-endian integer
+  // padded with zeros, with the characters mapped so the integers
+  // order as the characters do
+  inline uint64_t key8(arena const &A, string_ref s, size_t depth) {
+    constexpr uint64_t flip = std::is_signed<char>::value ? 0x80 : 0;
+    const unsigned char* p = (const unsigned char*) A.begin(s) + depth;
+    size_t r = (depth < s.length) ? s.length - depth : 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (r >= 8) {
+      uint64_t w;
+      memcpy(&w, p, 8);
+      return __builtin_bswap64(w) ^ (flip * 0x0101010101010101ull);
+    }
+#endif
+    uint64_t k = 0;
+    for (size_t i = 0; i < std::min<size_t>(r, 8); i++)
+      k |= ((uint64_t) (p[i] ^ flip)) << (56 - 8 * i);
+    return k;
+  }
+
+  // length of the common prefix of a and b, given it is at least depth
+  inline size_t lcp_from(arena const &A, string_ref a, string_ref b, size_t depth) {
+    size_t l = std::min(a.length, b.length);
+    const char* sa = A.begin(a);
+    const char* sb = A.begin(b);
+    while (depth < l && sa[depth] == sb[depth]) depth++;
+    return depth;
+  }
+
+  // compares a and b, given they agree on the first depth characters
+  inline bool less_from(arena const &A, string_ref a, string_ref b, size_t depth) {
+    size_t i = lcp_from(A, a, b, depth);
+    if (i == std::min(a.length, b.length)) return a.length < b.length;
+    return A.begin(a)[i] < A.begin(b)[i];
+  }
+
+  // Moves the strings of S of length at most len to the front, sorted
+  // by length, and returns how many there are.  If all strings of S
+  // agree on their first len characters (with the short ones padded
+  // by zeros), each moved string is a prefix of every later one.
+  inline size_t move_short_first(refs S, size_t len) {
+    auto is_short = [&] (string_ref s) {return s.length <= len;};
+    size_t f = parlay::count_if(S, is_short);
+    if (f == 0) return 0;
+    auto F = parlay::filter(S, is_short);
+    auto R = parlay::filter(S, [&] (string_ref s) {return !is_short(s);});
+    parlay::sort_inplace(F, [] (string_ref a, string_ref b) {
+	return a.length < b.length;});
+    parlay::parallel_for(0, S.size(), [&] (size_t i) {
+	S[i] = (i < f) ? F[i] : R[i - f];});
+    return f;
+  }
+
+  // start of each run of equal values of key
+  template <class Key>
+  parlay::sequence<size_t> run_starts(size_t n, Key key) {
+    return parlay::pack_index(parlay::delayed_tabulate(n, [&] (size_t i) {
+	  return i == 0 || key(i) != key(i-1);}));
+  }
+
+  // *************************************************************
+  //  MSD radix sort
+  // *************************************************************
+
+  constexpr size_t radix_base_size = 64;
+
+  // sorts S, whose strings agree on their first depth characters
+  inline void radix_sort_rec(arena const &A, refs S, size_t depth) {
+    size_t n = S.size();
+    if (n < 2) return;
+    if (n <= radix_base_size) {
+      std::sort(S.begin(), S.end(), [&] (string_ref a, string_ref b) {
+	  return less_from(A, a, b, depth);});
+      return;
+    }
+
+    // sort on the next 8 characters, keeping them with the handles
+    parlay::sequence<size_t> starts;
+    {
+      struct keyed {uint64_t key; string_ref s;};
+      auto K = parlay::tabulate(n, [&] (size_t i) {
+	  return keyed{key8(A, S[i], depth), S[i]};});
+      parlay::integer_sort_inplace(K, [] (keyed const &k) {return k.key;});
+      parlay::parallel_for(0, n, [&] (size_t i) {S[i] = K[i].s;});
+      starts = run_starts(n, [&] (size_t i) {return K[i].key;});
+    }
+
+    // recurse on the groups with equal keys, after removing the
+    // strings that end within them
+    size_t m = starts.size();
+    parlay::parallel_for(0, m, [&] (size_t j) {
+	size_t s = starts[j];
+	size_t e = (j + 1 == m) ? n : starts[j+1];
+	if (e - s > 1) {
+	  size_t f = move_short_first(S.cut(s, e), depth + 8);
+	  radix_sort_rec(A, S.cut(s + f, e), depth + 8);
+	}
+      }, 1);
+  }
+
+  inline parlay::sequence<string_ref> radix_sort(arena const &A) {
+    auto R = A.strs;
+    radix_sort_rec(A, parlay::make_slice(R), 0);
+    return R;
+  }
+
+  // *************************************************************
+  //  String sample sort
+  // *************************************************************
+
+  constexpr size_t sample_base_size = 64;
+  constexpr int max_tree_levels = 8;   // up to 255 splitters
+  constexpr int over_sample = 4;
+
+  // Sorts S, whose strings agree on their first depth characters,
+  // and sets L[i] to the lcp of S[i-1] and S[i] for 0 < i < |S|.
+  // Strings are classified on their next 8 characters into buckets
+  // strictly between two splitters, and buckets equal to a splitter.
+  // The classification searches an implicit binary tree of the
+  // splitters with no branches other than the loop.  Buckets between
+  // splitters recurse at the same depth, and buckets equal to a
+  // splitter at depth + 8.
+  inline void sample_sort_rec(arena const &A, refs S, lcp_t* L, size_t depth) {
+    size_t n = S.size();
+    if (n < 2) return;
+    if (n <= sample_base_size) {
+      std::sort(S.begin(), S.end(), [&] (string_ref a, string_ref b) {
+	  return less_from(A, a, b, depth);});
+      for (size_t i = 1; i < n; i++)
+	L[i] = (lcp_t) lcp_from(A, S[i-1], S[i], depth);
+      return;
+    }
+
+    // pick the splitters from a sorted sample
+    int levels = 1;
+    while (levels < max_tree_levels && (((size_t) 2) << levels) * 8 <= n) levels++;
+    size_t k = (((size_t) 1) << levels) - 1;
+    auto sample = parlay::tabulate((k + 1) * over_sample, [&] (size_t i) {
+	return key8(A, S[parlay::hash64(depth + i * n + n) % n], depth);});
+    std::sort(sample.begin(), sample.end());
+    uint64_t splitters[1 << max_tree_levels];
+    for (size_t j = 0; j < k; j++) splitters[j] = sample[(j + 1) * over_sample - 1];
+
+    // the splitters in heap order (children of i at 2i and 2i+1)
+    uint64_t tree[1 << max_tree_levels];
+    for (int l = 0; l < levels; l++) {
+      size_t stride = ((size_t) 1) << (levels - l);
+      for (size_t i = 0; i < (((size_t) 1) << l); i++)
+	tree[(((size_t) 1) << l) + i] = splitters[i * stride + stride/2 - 1];
+    }
+
+    // bucket 2j holds keys between splitters j-1 and j, and bucket
+    // 2j+1 holds keys equal to splitter j
+    auto classify = [&] (uint64_t key) -> unsigned short {
+      size_t i = 1;
+      for (int l = 0; l < levels; l++) i = 2 * i + (key > tree[i]);
+      size_t j = i - (k + 1);
+      return (unsigned short) (2 * j + (j < k && key == splitters[j]));
+    };
+
+    parlay::sequence<size_t> starts;
+    parlay::sequence<unsigned short> bucket_ids;
+    {
+      using tagged = std::pair<unsigned short, string_ref>;
+      auto B = parlay::tabulate(n, [&] (size_t i) {
+	  return tagged(classify(key8(A, S[i], depth)), S[i]);});
+      parlay::integer_sort_inplace(B, [] (tagged const &b) {return b.first;});
+      parlay::parallel_for(0, n, [&] (size_t i) {S[i] = B[i].second;});
+      starts = run_starts(n, [&] (size_t i) {return B[i].first;});
+      bucket_ids = parlay::map(starts, [&] (size_t s) {return B[s].first;});
+    }
+
+    size_t m = starts.size();
+    parlay::parallel_for(0, m, [&] (size_t j) {
+	size_t s = starts[j];
+	size_t e = (j + 1 == m) ? n : starts[j+1];
+	if (bucket_ids[j] % 2 == 0) {
+	  sample_sort_rec(A, S.cut(s, e), L + s, depth);
+	} else {
+	  // the short strings are prefixes of the ones after them
+	  size_t f = move_short_first(S.cut(s, e), depth + 8);
+	  for (size_t i = s + 1; i < std::min(s + f + 1, e); i++)
+	    L[i] = S[i-1].length;
+	  sample_sort_rec(A, S.cut(s + f, e), L + s + f, depth + 8);
+	}
+      }, 1);
+
+    // the lcps across bucket boundaries
+    parlay::parallel_for(1, m, [&] (size_t j) {
+	size_t s = starts[j];
+	L[s] = (lcp_t) lcp_from(A, S[s-1], S[s], depth);});
+  }
+
+  inline std::pair<parlay::sequence<string_ref>, parlay::sequence<lcp_t>>
+  sample_sort(arena const &A) {
+    auto R = A.strs;
+    auto L = parlay::sequence<lcp_t>(R.size(), 0);
+    sample_sort_rec(A, parlay::make_slice(R), L.data(), 0);
+    return std::make_pair(std::move(R), std::move(L));
+  }
+
+} // namespace string_sort
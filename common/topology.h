@@ -24,6 +24,7 @@
 #define _TOPOLOGY_INCLUDED
 
 #include <iostream>
+#include <climits>
 #include "geometry.h"
 
 using namespace std;
@@ -32,10 +33,11 @@ using namespace std;
 //    TOPOLOGY
 // *************************************************************
 
-template <typename point>
-struct vertex;
-
-// an unoriented triangle with its three neighbors and 3 vertices
+// Triangles and vertices are referred to by 32-bit indices into a
+// mesh.  Each triangle holds its three vertices and the neighbor
+// across the edge from vertex i to the previous one in ngh[i]
+// (null_id on the boundary).  Fields that are rarely touched are kept
+// in separate arrays so the walks only load the 24-byte triangles.
 //          vtx[1]
 //           o 
 //           | \ -> ngh[1]
@@ -43,126 +45,136 @@ struct vertex;
 //           | / -> ngh[0]
 //           o
 //         vtx[2]
-template <typename point>
+using tri_id = unsigned int;
+using vtx_id = unsigned int;
+constexpr unsigned int null_id = UINT_MAX;
+
 struct triangle {
-  using tri_t = triangle<point>;
-  using vtx_t = vertex<point>;
-  tri_t *ngh [3];
-  vtx_t *vtx [3];
-  size_t id;
-  bool initialized;
-  char bad;  // used to mark badly shaped triangles
-  void setT(tri_t *t1, tri_t *t2, tri_t* t3) {
-    ngh[0] = t1; ngh[1] = t2; ngh[2] = t3; }
-  void setV(vtx_t *v1, vtx_t *v2, vtx_t *v3) {
-    vtx[0] = v1; vtx[1] = v2; vtx[2] = v3; }
-  int locate(tri_t *t) {
-    for (int i=0; i < 3; i++) {
-      //cout << t << ", " << ngh[i] << endl;
-      if (ngh[i] == t) return i;
-    }
-    cout<<"did not locate back pointer in triangulation\n";
-    abort(); // did not find
-  }
-  void update(tri_t *t, tri_t *tn) {
-    for (int i=0; i < 3; i++)
-      if (ngh[i] == t) {ngh[i] = tn; return;}
-    cout<<"did not update\n";
-    abort(); // did not find
-  }
+  vtx_id vtx[3];
+  tri_id ngh[3];
 };
 
-// a vertex pointing to an arbitrary triangle to which it belongs (if any)
+// a vertex with an arbitrary triangle to which it belongs (if any)
 template <typename point>
 struct vertex {
   using point_t = point;
-  using tri = triangle<point>;
+  using pointT = point;  // as used by oct_tree
   point pt;
-  tri *t;
-  tri *badT;
+  tri_id t;
   int id;
   int reserve;
-  size_t counter;
+  unsigned int counter;  // used by the nearest neighbor structure
   void print() {
     cout << id << " (" << pt.x << "," << pt.y << ") " << endl;
   }
-  vertex(point p, size_t i) : pt(p), id(i), reserve(-1)
-			    , badT(NULL)
-  {}
+  vertex(point p, size_t i) : pt(p), t(null_id), id(i), reserve(-1) {}
   vertex() {}
 };
 
+template <typename point>
+struct mesh {
+  using vtx_t = vertex<point>;
+  parlay::sequence<vtx_t> V;
+  parlay::sequence<triangle> T;
+  parlay::sequence<char> initialized;
+  parlay::sequence<char> bad;    // used to mark badly shaped triangles
+
+  mesh() {}
+  mesh(size_t num_vertices, size_t num_triangles)
+    : V(num_vertices),
+      T(num_triangles, triangle{{null_id, null_id, null_id}, {null_id, null_id, null_id}}),
+      initialized(num_triangles, 0), bad(num_triangles, 0) {}
+
+  size_t num_triangles() {return T.size();}
+  vtx_id index(vtx_t *v) {return (vtx_id) (v - V.data());}
+  vtx_t *vertex_of(tri_id t, int i) {return &V[T[t].vtx[i]];}
+
+  void set(tri_id t, vtx_id v0, vtx_id v1, vtx_id v2,
+	   tri_id t0, tri_id t1, tri_id t2) {
+    T[t] = triangle{{v0, v1, v2}, {t0, t1, t2}};
+  }
+  int locate(tri_id t, tri_id s) {
+    for (int i=0; i < 3; i++)
+      if (T[t].ngh[i] == s) return i;
+    cout<<"did not locate back pointer in triangulation\n";
+    abort(); // did not find
+  }
+  void update(tri_id t, tri_id s, tri_id sn) {
+    for (int i=0; i < 3; i++)
+      if (T[t].ngh[i] == s) {T[t].ngh[i] = sn; return;}
+    cout<<"did not update\n";
+    abort(); // did not find
+  }
+};
+
 inline int mod3(int i) {return (i>2) ? i-3 : i;}
 
 // a simplex is just an oriented triangle.  An integer (o)
 // is used to indicate which of 3 orientations it is in (0,1,2)
-// If boundary is set then it represents the edge through t.ngh[o],
-// which is a NULL pointer.
+// If boundary is set then it represents the edge through ngh[o],
+// which is null.
 template <typename point>
 struct simplex {
   using vtx_t = vertex<point>;
-  using tri_t = triangle<point>;
-  tri_t *t;
-  int o;
+  using mesh_t = mesh<point>;
+  // kept to 16 bytes so that it is passed in registers
+  mesh_t *m;
+  tri_id t;
+  short o;
   bool boundary;
-  simplex(tri_t *tt, int oo) : t(tt), o(oo), boundary(0) {}
-  simplex(tri_t *tt, int oo, bool _b) : t(tt), o(oo), boundary(_b) {}
-  simplex(vtx_t *v1, vtx_t *v2, vtx_t *v3, tri_t *tt) {
-    t = tt;
-    t->ngh[0] = t->ngh[1] = t->ngh[2] = NULL;
-    t->vtx[0] = v1; v1->t = t;
-    t->vtx[1] = v2; v2->t = t;
-    t->vtx[2] = v3; v3->t = t;
+  simplex(mesh_t *mm, tri_id tt, int oo) : m(mm), t(tt), o(oo), boundary(0) {}
+  simplex(mesh_t *mm, tri_id tt, int oo, bool _b) : m(mm), t(tt), o(oo), boundary(_b) {}
+  simplex(mesh_t *mm, vtx_t *v1, vtx_t *v2, vtx_t *v3, tri_id tt) : m(mm), t(tt) {
+    m->set(t, m->index(v1), m->index(v2), m->index(v3), null_id, null_id, null_id);
+    v1->t = v2->t = v3->t = t;
     o = 0;
     boundary = 0;
   }
-  simplex() : t(nullptr), o(0), boundary(false) {}
+  simplex() : m(nullptr), t(null_id), o(0), boundary(false) {}
+
+  // vertex i of the triangle (ignoring the orientation)
+  vtx_t *vtx(int i) {return m->vertex_of(t, i);}
 
   void print() {
-    if (t == NULL) cout << "NULL simp" << endl;
+    if (t == null_id) cout << "NULL simp" << endl;
     else {
       cout << "vtxs=";
-      for (int i=0; i < 3; i++) 
-	if (t->vtx[mod3(i+o)] != NULL)
-	  cout << t->vtx[mod3(i+o)]->id << " (" <<
-	    t->vtx[mod3(i+o)]->pt.x << "," <<
-	    t->vtx[mod3(i+o)]->pt.y << ") ";
-	else cout << "NULL ";
+      for (int i=0; i < 3; i++) {
+	vtx_t *v = vtx(mod3(i+o));
+	cout << v->id << " (" << v->pt.x << "," << v->pt.y << ") ";
+      }
       cout << endl;
     }
   }
 
   simplex across() {
-    tri_t *to = t->ngh[o];
-    if (to != NULL) return simplex(to,to->locate(t));
-    else return simplex(t,o,1);
+    tri_id to = m->T[t].ngh[o];
+    if (to != null_id) return simplex(m,to,m->locate(to,t));
+    else return simplex(m,t,o,1);
   }
 
   // depending on initial triangle this could be counterclockwise
-  simplex rotClockwise() { return simplex(t,mod3(o+1));}
+  simplex rotClockwise() { return simplex(m,t,mod3(o+1));}
 
   bool valid() {return (!boundary);}
   bool isTriangle() {return (!boundary);}
   bool isBoundary() {return boundary;}
   
-  vtx_t *firstVertex() {return t->vtx[o];}
+  vtx_t *firstVertex() {return vtx(o);}
 
   bool inCirc(vtx_t *v) {
-    if (boundary || t == NULL) return 0;
-    return inCircle(t->vtx[0]->pt, t->vtx[1]->pt, 
-		    t->vtx[2]->pt, v->pt);
+    if (boundary || t == null_id) return 0;
+    return inCircle(vtx(0)->pt, vtx(1)->pt, vtx(2)->pt, v->pt);
   }
 
   // the angle facing the across edge
   double farAngle() {
-    return angle(t->vtx[mod3(o+1)]->pt,
-		 t->vtx[o]->pt,
-		 t->vtx[mod3(o+2)]->pt);
+    return angle(vtx(mod3(o+1))->pt, vtx(o)->pt, vtx(mod3(o+2))->pt);
   }
 
   bool outside(vtx_t *v) {
-    if (boundary || t == NULL) return 0;
-    return counterClockwise(t->vtx[mod3(o+2)]->pt, v->pt, t->vtx[o]->pt);
+    if (boundary || t == null_id) return 0;
+    return counterClockwise(vtx(mod3(o+2))->pt, v->pt, vtx(o)->pt);
   }
 
   // flips two triangles and adjusts neighboring triangles
@@ -170,74 +182,77 @@ struct simplex {
     simplex s = across();
     int o1 = mod3(o+1);
     int os1 = mod3(s.o+1);
+    triangle &a = m->T[t], &b = m->T[s.t];
+
+    tri_id t1 = a.ngh[o1];
+    tri_id t2 = b.ngh[os1];
+    vtx_id v1 = a.vtx[o1];
+    vtx_id v2 = b.vtx[os1];
 
-    tri_t *t1 = t->ngh[o1];
-    tri_t *t2 = s.t->ngh[os1];
-    vtx_t *v1 = t->vtx[o1];
-    vtx_t *v2 = s.t->vtx[os1];
-
-    t->vtx[o]->t = s.t;
-    t->vtx[o] = v2;
-    t->ngh[o] = t2;
-    if (t2 != NULL) t2->update(s.t,t);
-    t->ngh[o1] = s.t;
-
-    s.t->vtx[s.o]->t = t;
-    s.t->vtx[s.o] = v1;
-    s.t->ngh[s.o] = t1;
-    if (t1 != NULL) t1->update(t,s.t);
-    s.t->ngh[os1] = t;
+    m->V[a.vtx[o]].t = s.t;
+    a.vtx[o] = v2;
+    a.ngh[o] = t2;
+    if (t2 != null_id) m->update(t2,s.t,t);
+    a.ngh[o1] = s.t;
+
+    m->V[b.vtx[s.o]].t = t;
+    b.vtx[s.o] = v1;
+    b.ngh[s.o] = t1;
+    if (t1 != null_id) m->update(t1,t,s.t);
+    b.ngh[os1] = t;
   }
 
   // splits the triangle into three triangles with new vertex v in the middle
   // updates all neighboring simplices
-  // ta0 and ta0 are pointers to the memory to use for the two new triangles
-  void split(vtx_t* v, tri_t* ta0, tri_t* ta1) {
+  // ta0 and ta1 are the slots to use for the two new triangles
+  void split(vtx_t* v, tri_id ta0, tri_id ta1) {
     v->t = t;
-    tri_t *t1 = t->ngh[0]; tri_t *t2 = t->ngh[1]; tri_t *t3 = t->ngh[2];
-    vtx_t *v1 = t->vtx[0]; vtx_t *v2 = t->vtx[1]; vtx_t *v3 = t->vtx[2];
-    t->ngh[1] = ta0;        t->ngh[2] = ta1;
-    t->vtx[1] = v;
-    ta0->setT(t2,ta1,t);  ta0->setV(v2,v,v1);
-    ta1->setT(t3,t,ta0);  ta1->setV(v3,v,v2);
-    if (t2 != NULL) t2->update(t,ta0);      
-    if (t3 != NULL) t3->update(t,ta1);
-    v2->t = ta0;
+    vtx_id vi = m->index(v);
+    triangle &a = m->T[t];
+    tri_id t2 = a.ngh[1]; tri_id t3 = a.ngh[2];
+    vtx_id v1 = a.vtx[0]; vtx_id v2 = a.vtx[1]; vtx_id v3 = a.vtx[2];
+    a.ngh[1] = ta0;        a.ngh[2] = ta1;
+    a.vtx[1] = vi;
+    m->set(ta0, v2, vi, v1, t2, ta1, t);
+    m->set(ta1, v3, vi, v2, t3, t, ta0);
+    if (t2 != null_id) m->update(t2,t,ta0);
+    if (t3 != null_id) m->update(t3,t,ta1);
+    m->V[v2].t = ta0;
   }
 
   // splits one of the boundaries of a triangle to form two triangles
-  // the orientation dictates which edge to split (i.e., t.ngh[o])
-  // ta is a pointer to memory to use for the new triangle
-  void splitBoundary(vtx_t* v, tri_t* ta) {
+  // the orientation dictates which edge to split (i.e., ngh[o])
+  // ta is the slot to use for the new triangle
+  void splitBoundary(vtx_t* v, tri_id ta) {
     int o1 = mod3(o+1);
     int o2 = mod3(o+2);
-    if (t->ngh[o] != NULL) {
+    triangle &a = m->T[t];
+    if (a.ngh[o] != null_id) {
       cout << "simplex::splitBoundary: not boundary" << endl; abort();}
     v->t = t;
-    tri_t *t2 = t->ngh[o2];
-    vtx_t *v1 = t->vtx[o1]; vtx_t *v2 = t->vtx[o2];
-    t->ngh[o2] = ta;   t->vtx[o2] = v;
-    ta->setT(t2,NULL,t);  ta->setV(v2,v,v1);
-    if (t2 != NULL) t2->update(t,ta);      
-    v2->t = t;
+    vtx_id vi = m->index(v);
+    tri_id t2 = a.ngh[o2];
+    vtx_id v1 = a.vtx[o1]; vtx_id v2 = a.vtx[o2];
+    a.ngh[o2] = ta;   a.vtx[o2] = vi;
+    m->set(ta, v2, vi, v1, t2, null_id, t);
+    if (t2 != null_id) m->update(t2,t,ta);
+    m->V[v2].t = ta;
   }
 
-  // given a vtx v, extends a boundary edge (t.ngh[o]) with an extra 
+  // given a vtx v, extends a boundary edge (ngh[o]) with an extra 
   // triangle on that edge with apex v.  
-  // ta is used as the memory for the triangle
-  simplex extend(vtx_t* v, tri_t* ta) {
-    if (t->ngh[o] != NULL) {
+  // ta is used as the slot for the triangle
+  simplex extend(vtx_t* v, tri_id ta) {
+    triangle &a = m->T[t];
+    if (a.ngh[o] != null_id) {
       cout << "simplex::extend: not boundary" << endl; abort();}
-    t->ngh[o] = ta;
-    ta->setV(t->vtx[o], t->vtx[mod3(o+2)], v);
-    ta->setT(NULL,t,NULL);
+    a.ngh[o] = ta;
+    m->set(ta, a.vtx[o], a.vtx[mod3(o+2)], m->index(v),
+	   null_id, t, null_id);
     v->t = ta;
-    return simplex(ta,0);
+    return simplex(m,ta,0);
   }
 
 };
 
-// this might or might not be needed
-// void topologyFromTriangles(triangles<point2d> Tri, vtx** vr, tri** tr);
-
 #endif // _TOPOLOGY_INCLUDED
@@ -40,12 +40,12 @@ using std::cout;
 using std::endl;
 using std::less;
 
-using triang_t = triangle<point>;
 using vertex_t = vertex<point>;
 using simplex_t = simplex<point>;
+using mesh_t = mesh<point>;
 using index_t = int;
 using index_pair = pair<index_t,index_t>;
-using edge = pair<index_pair, triang_t*>;
+using edge = pair<index_pair, tri_id>;
 
 // Hash table to store skinny triangles
 struct hashEdges {
@@ -71,53 +71,51 @@ using EdgeTable = hashtable<hashEdges>;
 EdgeTable makeEdgeTable(size_t m) {
   return EdgeTable(m,hashEdges());}
 
-std::pair<sequence<triang_t>,sequence<vertex_t>>
-topology_from_triangles(triangles<point> &Tri, size_t extra_points = 0) {
+// Builds a mesh from the triangles, leaving room for extra_points
+// more vertices and two more triangles for each of them.
+mesh_t topology_from_triangles(triangles<point> &Tri, size_t extra_points = 0) {
   size_t n = Tri.numPoints();
   size_t m = Tri.numTriangles();
 
-  auto V = tabulate(n + extra_points, [&] (size_t i) {
+  mesh_t M(0, m + 2 * extra_points);
+  M.V = tabulate(n + extra_points, [&] (size_t i) {
     return (i < n) ? vertex_t(Tri.P[i], i) : vertex_t();});
 
-  sequence<triang_t> Triangs(m + 2 * extra_points);
   sequence<edge> E(m*3);
   EdgeTable ET = makeEdgeTable(m*6);
   parallel_for (0, m, [&] (size_t i) {
     for (int j=0; j<3; j++) {
-      E[i*3 + j] = edge(index_pair(Tri.T[i][j], Tri.T[i][(j+1)%3]), &Triangs[i]);
+      E[i*3 + j] = edge(index_pair(Tri.T[i][j], Tri.T[i][(j+1)%3]), i);
       ET.insert(&E[i*3+j]);
-      Triangs[i].vtx[(j+2)%3] = &V[Tri.T[i][j]];
+      M.T[i].vtx[(j+2)%3] = Tri.T[i][j];
     }});
 
   parallel_for (0, m, [&] (size_t i) {
-    Triangs[i].id = i;
-    Triangs[i].initialized = 1;
-    Triangs[i].bad = 0;
+    M.initialized[i] = 1;
+    M.bad[i] = 0;
     for (int j=0; j<3; j++) {
       index_pair key = {Tri.T[i][(j+1)%3], Tri.T[i][j]};
       edge *Ed = ET.find(key);
-      if (Ed != NULL) Triangs[i].ngh[j] = Ed->second;
-      else {
-	Triangs[i].ngh[j] = NULL;
-	//Triangs[i].vtx[j]->boundary = 1;
-	//Triangs[i].vtx[(j+2)%3]->boundary = 1;
-      }
+      M.T[i].ngh[j] = (Ed != NULL) ? Ed->second : null_id;
     }
   });
-  return std::pair(std::move(Triangs),std::move(V));
+  return M;
 }
 
 // Note that this is not currently a complete test of correctness
 // For example it would allow a set of disconnected triangles, or even no
 // triangles
-bool check_delaunay(sequence<triang_t> &Triangles, size_t boundary_size) {
-  size_t n = Triangles.size();
+// The tests are exact.  If tolerance is positive a violation is only
+// reported if it is larger than tolerance after normalizing, which
+// allows for points that were rounded when written out.
+bool check_delaunay(mesh_t &M, size_t boundary_size, double tolerance = 0.0) {
+  size_t n = M.num_triangles();
   sequence<size_t> boundary_count(n, 0);
   size_t insideOutError = n;
   size_t inCircleError = n;
   parallel_for (0, n, [&] (size_t i) {
-    if (Triangles[i].initialized) {
-      simplex_t t = simplex(&Triangles[i],0);
+    if (M.initialized[i]) {
+      simplex_t t = simplex_t(&M,i,0);
       for (int j=0; j < 3; j++) {
 	simplex_t a = t.across();
 	if (a.valid()) {
@@ -125,18 +123,16 @@ bool check_delaunay(sequence<triang_t> &Triangles, size_t boundary_size) {
 
           // Check that the neighbor is outside the triangle
 	  if (!t.outside(v)) {
-	    double vz = triAreaNormalized(t.t->vtx[(t.o+2)%3]->pt, 
-					  v->pt, t.t->vtx[t.o]->pt);
-	    // allow for small error
-	    if (vz < -1e-10) pbbs::write_min(&insideOutError, i, less<size_t>());
+	    if (tolerance == 0.0 ||
+		triAreaNormalized(t.vtx((t.o+2)%3)->pt, v->pt, t.vtx(t.o)->pt) < -tolerance)
+	      pbbs::write_min(&insideOutError, i, less<size_t>());
 	  }
 
           // Check that the neighbor is not in circumcircle of the triangle
 	  if (t.inCirc(v)) {
-	    double vz = inCircleNormalized(t.t->vtx[0]->pt, t.t->vtx[1]->pt, 
-					   t.t->vtx[2]->pt, v->pt);
-	    // allow for small error
-	    if (vz > 1e-10) pbbs::write_min(&inCircleError, i, less<size_t>());
+	    if (tolerance == 0.0 ||
+		inCircleNormalized(t.vtx(0)->pt, t.vtx(1)->pt, t.vtx(2)->pt, v->pt) > tolerance)
+	      pbbs::write_min(&inCircleError, i, less<size_t>());
 	  }
 	} else boundary_count[i]++;
 	t = t.rotClockwise();
@@ -149,7 +145,7 @@ bool check_delaunay(sequence<triang_t> &Triangles, size_t boundary_size) {
 
   if (insideOutError < n) {
     cout << "delaunayCheck: neighbor inside triangle at triangle " 
-	 << inCircleError << endl;
+	 << insideOutError << endl;
     return 1;
   }
   if (inCircleError < n) {